@@ -1,16 +1,34 @@
 #include <algorithm>
+#include <cerrno>
+#include <charconv>
 #include <chrono>
 #include <cstring>
+#include <format>
+#include <fstream>
 #include <iostream>
+#include <new>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
 #include <sys/msg.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <vector>
 
 constexpr size_t message_size = 1 << 10;
 constexpr size_t output_interval = 1e6;
 constexpr size_t round = 1e7;
 constexpr uint64_t generating_seed = 2022212720;
 constexpr long message_type = 1;
+constexpr size_t default_msgmax = 8192;
+constexpr size_t default_msgmnb = 16384;
+constexpr size_t fragment_frame_sizes[] = {1 << 10, 1 << 12, 1 << 14, 1 << 16, 1 << 18, 1 << 20, 1 << 22};
+constexpr size_t fragment_total_bytes = 1 << 28; // per frame size
+constexpr size_t fragments_in_flight = 4;
+constexpr size_t channel_round = 5e5;
+constexpr size_t channel_reader_counts[] = {1, 2, 4, 8};
+constexpr size_t channel_max_readers = 64;
+constexpr uint64_t channel_stop = UINT64_MAX;
 
 struct frame {
     std::byte data[message_size];
@@ -27,6 +45,78 @@ struct message {
     frame data;
 };
 
+// A batch is sent as one message: the header is followed by up to K frames.
+// generated_ns is taken when the first frame of the batch is generated.
+struct batch_header {
+    long msg_type;
+    uint64_t generated_ns;
+};
+
+// Frames larger than msgmax travel as a run of fragments, each one message
+// carrying its place in the frame. With a single writer the queue delivers
+// them in order, so the reader only has to check the numbering.
+struct fragment_header {
+    long msg_type;
+    uint64_t frame;        // sequence number of the frame
+    uint32_t index;        // position of this fragment in the frame
+    uint32_t count;        // fragments in the frame
+    uint64_t generated_ns; // when the writer started sending the frame
+};
+
+constexpr size_t fragment_header_size = sizeof(fragment_header) - sizeof(long); // counted by msgsnd
+
+struct fragment_layout {
+    size_t frame_size;
+    size_t payload; // frame bytes per fragment
+    size_t count;   // fragments per frame
+    size_t rounds;  // frames to send
+};
+
+enum class dispatch_policy {
+    round_robin,
+    hash,
+};
+
+// One frame for one of the M readers. On the shared queue the reader is
+// chosen by msg_type, on per-reader queues msg_type is always message_type.
+struct channel_message {
+    long msg_type;
+    uint64_t index; // channel_stop tells the reader to finish
+    uint64_t generated_ns;
+    frame data;
+};
+
+constexpr size_t channel_payload = sizeof(channel_message) - sizeof(long);
+
+struct channel_reader_statistics {
+    uint64_t frames;
+    uint64_t latency_ns; // sum over the frames
+    uint64_t finished_ns;
+};
+
+struct channel_control {
+    uint64_t start_ns;
+    channel_reader_statistics readers[channel_max_readers];
+};
+
+static inline auto read_kernel_limit(const char *name, size_t fallback) -> size_t {
+    std::ifstream file(std::format("/proc/sys/kernel/{}", name));
+    size_t value = fallback;
+    if (!(file >> value))
+        std::cerr << std::format("Failed to read /proc/sys/kernel/{}, assuming {}", name, fallback) << std::endl;
+    return value;
+}
+
+static inline auto monotonic_ns() -> uint64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static inline auto batch_frames(std::byte *buffer) -> frame * {
+    return reinterpret_cast<frame *>(buffer + sizeof(batch_header));
+}
+
 static inline auto writer(const int msgid) -> void {
     auto start_time = std::chrono::high_resolution_clock::now();
 
@@ -95,7 +185,519 @@ static inline auto reader(const int msgid) -> void {
     std::cout << std::format("Reader total speed: {} MiB/s", total_speed) << std::endl;
 }
 
-int main() {
+static inline auto batch_writer(const int msgid, const size_t batch_size) -> void {
+    std::byte *buffer = new std::byte[sizeof(batch_header) + batch_size * sizeof(frame)];
+    batch_header *header = reinterpret_cast<batch_header *>(buffer);
+    frame *frames = batch_frames(buffer);
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    for (size_t i = 0; i < round; i += batch_size) {
+        const size_t count = std::min(batch_size, round - i);
+
+        header->msg_type = message_type;
+        header->generated_ns = monotonic_ns();
+        for (size_t j = 0; j < count; ++j)
+            frames[j].generate(generating_seed + i + j);
+
+        const size_t payload = sizeof(header->generated_ns) + count * sizeof(frame);
+        if (msgsnd(msgid, buffer, payload, 0) == -1) {
+            perror("msgsnd");
+            exit(EXIT_FAILURE);
+        }
+    }
+    delete[] buffer;
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> total_elapsed = end_time - start_time;
+    double total_speed = round * message_size / (1024.0 * 1024.0) / total_elapsed.count();
+
+    std::cout
+        << std::format("Writer K = {}: {} MiB/s, {} frames/s", batch_size, total_speed, round / total_elapsed.count())
+        << std::endl;
+}
+
+static inline auto batch_reader(const int msgid, const size_t batch_size) -> void {
+    frame *expected_frame = new frame;
+    std::byte *buffer = new std::byte[sizeof(batch_header) + batch_size * sizeof(frame)];
+    batch_header *header = reinterpret_cast<batch_header *>(buffer);
+    [[maybe_unused]] frame *frames = batch_frames(buffer);
+    uint64_t latency_sum = 0, latency_max = 0;
+    size_t batches = 0;
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    for (size_t i = 0; i < round;) {
+        const size_t payload = sizeof(header->generated_ns) + batch_size * sizeof(frame);
+        auto result = msgrcv(msgid, buffer, payload, message_type, 0);
+        if (result == -1) {
+            perror("msgrcv");
+            exit(EXIT_FAILURE);
+        }
+        const uint64_t latency = monotonic_ns() - header->generated_ns;
+        latency_sum += latency;
+        latency_max = std::max(latency_max, latency);
+        ++batches;
+
+        const size_t count = (result - sizeof(header->generated_ns)) / sizeof(frame);
+#ifdef FRAME_CHECK
+        for (size_t j = 0; j < count; ++j) {
+            expected_frame->generate(generating_seed + i + j);
+            if (!(frames[j] == *expected_frame))
+                std::cerr << std::format("Data mismatch at round {}", i + j) << std::endl;
+        }
+#endif
+        i += count;
+    }
+    delete expected_frame;
+    delete[] buffer;
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> total_elapsed = end_time - start_time;
+    double total_speed = round * message_size / (1024.0 * 1024.0) / total_elapsed.count();
+
+    std::cout
+        << std::format("Reader K = {}: {} MiB/s, {} frames/s, batch latency avg {} us, max {} us",
+                       batch_size, total_speed, round / total_elapsed.count(),
+                       latency_sum / 1e3 / batches, latency_max / 1e3)
+        << std::endl;
+}
+
+static inline auto run_batch(const size_t batch_size) -> void {
+    int msgid = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+    if (msgid == -1) {
+        perror("msgget");
+        exit(EXIT_FAILURE);
+    }
+
+    auto pid = fork();
+    if (pid) {
+        batch_writer(msgid, batch_size);
+        wait(nullptr);
+    } else {
+        batch_reader(msgid, batch_size);
+        exit(EXIT_SUCCESS);
+    }
+
+    if (msgctl(msgid, IPC_RMID, nullptr) == -1) {
+        perror("msgctl");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static inline auto batch(const size_t requested) -> void {
+    const size_t msgmax = read_kernel_limit("msgmax", default_msgmax);
+    const size_t msgmnb = read_kernel_limit("msgmnb", default_msgmnb);
+    // a new queue's msg_qbytes is msgmnb, and a message larger than that never fits
+    const size_t limit = std::min(msgmax, msgmnb);
+    const size_t max_batch = limit < sizeof(uint64_t) + message_size
+                                 ? 0
+                                 : (limit - sizeof(uint64_t)) / message_size;
+    if (max_batch == 0) {
+        std::cerr << std::format("min(msgmax, msgmnb) = {} cannot hold a single {} B frame", limit, message_size)
+                  << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<size_t> batch_sizes;
+    if (requested) {
+        if (requested > max_batch)
+            std::cout << std::format("K = {} does not fit in one message, using K = {}", requested, max_batch) << std::endl;
+        batch_sizes.push_back(std::min(requested, max_batch));
+    } else {
+        for (size_t k = 1; k < max_batch; k <<= 1)
+            batch_sizes.push_back(k);
+        batch_sizes.push_back(max_batch);
+    }
+
+    std::cout
+        << std::format("msgmax = {} B, msgmnb = {} B, at most {} frames per message", msgmax, msgmnb, max_batch)
+        << std::endl;
+    for (size_t batch_size : batch_sizes) {
+        if (2 * (sizeof(uint64_t) + batch_size * message_size) > msgmnb)
+            std::cout
+                << std::format("K = {}: msgmnb holds less than two batches, writer and reader will not overlap", batch_size)
+                << std::endl;
+        run_batch(batch_size);
+    }
+}
+
+static inline auto send_fragmented(const int msgid, const uint64_t frame_number, const std::byte *data,
+                                   const fragment_layout &layout, std::byte *buffer) -> void {
+    fragment_header header{message_type, frame_number, 0, static_cast<uint32_t>(layout.count), monotonic_ns()};
+    for (size_t offset = 0; offset < layout.frame_size; offset += layout.payload, ++header.index) {
+        const size_t length = std::min(layout.payload, layout.frame_size - offset);
+        std::memcpy(buffer, &header, sizeof(header));
+        std::memcpy(buffer + sizeof(header), data + offset, length);
+        if (msgsnd(msgid, buffer, fragment_header_size + length, 0) == -1) {
+            perror("msgsnd");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// Reassembles the next frame into data and returns when its sending started.
+static inline auto receive_fragmented(const int msgid, const uint64_t frame_number, std::byte *data,
+                                      const fragment_layout &layout, std::byte *buffer) -> uint64_t {
+    uint64_t generated_ns = 0;
+    for (size_t index = 0; index < layout.count; ++index) {
+        auto result = msgrcv(msgid, buffer, fragment_header_size + layout.payload, message_type, 0);
+        if (result == -1) {
+            perror("msgrcv");
+            exit(EXIT_FAILURE);
+        }
+        fragment_header header;
+        std::memcpy(&header, buffer, sizeof(header));
+        const size_t offset = index * layout.payload;
+        const size_t length = result - fragment_header_size;
+        if (header.frame != frame_number || header.index != index || offset + length > layout.frame_size) {
+            std::cerr
+                << std::format("Fragment {} of frame {} arrived where fragment {} of frame {} was expected",
+                               header.index, header.frame, index, frame_number)
+                << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        if (index == 0)
+            generated_ns = header.generated_ns;
+        std::memcpy(data + offset, buffer + sizeof(header), length);
+    }
+    return generated_ns;
+}
+
+static inline auto fragment_writer(const int msgid, const fragment_layout &layout) -> void {
+    std::vector<std::byte> data(layout.frame_size);
+    std::byte *buffer = new std::byte[sizeof(fragment_header) + layout.payload];
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    for (size_t i = 0; i < layout.rounds; ++i) {
+        std::fill(data.begin(), data.end(), static_cast<std::byte>(generating_seed + i));
+        send_fragmented(msgid, i, data.data(), layout, buffer);
+    }
+    delete[] buffer;
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> total_elapsed = end_time - start_time;
+    double total_speed = layout.rounds * layout.frame_size / (1024.0 * 1024.0) / total_elapsed.count();
+
+    std::cout
+        << std::format("Writer {} B frames in {} fragments: {} MiB/s, {} frames/s",
+                       layout.frame_size, layout.count, total_speed, layout.rounds / total_elapsed.count())
+        << std::endl;
+}
+
+static inline auto fragment_reader(const int msgid, const fragment_layout &layout) -> void {
+    std::vector<std::byte> data(layout.frame_size);
+    [[maybe_unused]] std::vector<std::byte> expected(layout.frame_size);
+    std::byte *buffer = new std::byte[sizeof(fragment_header) + layout.payload];
+    uint64_t latency_sum = 0, latency_max = 0;
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    for (size_t i = 0; i < layout.rounds; ++i) {
+        const uint64_t generated_ns = receive_fragmented(msgid, i, data.data(), layout, buffer);
+        const uint64_t latency = monotonic_ns() - generated_ns;
+        latency_sum += latency;
+        latency_max = std::max(latency_max, latency);
+
+#ifdef FRAME_CHECK
+        std::fill(expected.begin(), expected.end(), static_cast<std::byte>(generating_seed + i));
+        if (data != expected)
+            std::cerr << std::format("Data mismatch at round {}", i) << std::endl;
+#endif
+    }
+    delete[] buffer;
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> total_elapsed = end_time - start_time;
+    double total_speed = layout.rounds * layout.frame_size / (1024.0 * 1024.0) / total_elapsed.count();
+
+    std::cout
+        << std::format("Reader {} B frames in {} fragments: {} MiB/s, {} frames/s, frame latency avg {} us, max {} us",
+                       layout.frame_size, layout.count, total_speed, layout.rounds / total_elapsed.count(),
+                       latency_sum / 1e3 / layout.rounds, latency_max / 1e3)
+        << std::endl;
+}
+
+// Fragments are sized so that fragments_in_flight of them fit in the queue
+// at once, letting the writer fill the next ones while the reader drains.
+// The queue is first grown towards fragments_in_flight * msgmax, which needs
+// CAP_SYS_RESOURCE beyond msgmnb; without it the fragments shrink instead.
+static inline auto fragment_queue(const size_t msgmax, size_t &fragment_size) -> int {
+    int msgid = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+    if (msgid == -1) {
+        perror("msgget");
+        exit(EXIT_FAILURE);
+    }
+
+    msqid_ds state;
+    if (msgctl(msgid, IPC_STAT, &state) == -1) {
+        perror("msgctl IPC_STAT");
+        exit(EXIT_FAILURE);
+    }
+    const size_t wanted = fragments_in_flight * msgmax;
+    if (state.msg_qbytes < wanted) {
+        const msglen_t original = state.msg_qbytes;
+        state.msg_qbytes = wanted;
+        if (msgctl(msgid, IPC_SET, &state) == -1) {
+            if (errno != EPERM) {
+                perror("msgctl IPC_SET");
+                exit(EXIT_FAILURE);
+            }
+            state.msg_qbytes = original;
+        }
+    }
+
+    fragment_size = std::min(msgmax, static_cast<size_t>(state.msg_qbytes) / fragments_in_flight);
+    std::cout
+        << std::format("msgmax = {} B, queue holds {} B, {} B fragments with {} B of frame each",
+                       msgmax, state.msg_qbytes, fragment_size, fragment_size - fragment_header_size)
+        << std::endl;
+    return msgid;
+}
+
+static inline auto fragment(const size_t requested) -> void {
+    const size_t msgmax = read_kernel_limit("msgmax", default_msgmax);
+    size_t fragment_size;
+    int msgid = fragment_queue(msgmax, fragment_size);
+    if (fragment_size <= fragment_header_size) {
+        std::cerr << std::format("{} B fragments leave no room after the {} B header", fragment_size, fragment_header_size) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<size_t> frame_sizes(std::begin(fragment_frame_sizes), std::end(fragment_frame_sizes));
+    if (requested)
+        frame_sizes = {requested};
+
+    for (size_t frame_size : frame_sizes) {
+        fragment_layout layout{frame_size, fragment_size - fragment_header_size, 0, 0};
+        layout.count = (frame_size + layout.payload - 1) / layout.payload;
+        layout.rounds = std::max<size_t>(1, fragment_total_bytes / frame_size);
+
+        std::cout << std::flush;
+        auto pid = fork();
+        if (pid == -1) {
+            perror("fork");
+            exit(EXIT_FAILURE);
+        }
+        if (pid == 0) {
+            fragment_reader(msgid, layout);
+            exit(EXIT_SUCCESS);
+        }
+        fragment_writer(msgid, layout);
+        wait(nullptr);
+    }
+
+    if (msgctl(msgid, IPC_RMID, nullptr) == -1) {
+        perror("msgctl");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Round robin spreads frames evenly. Hashing stands for dispatching on a
+// key carried by the frame (a flow or a symbol): splitmix64 of the index
+// gives an even spread only on average, as real keys do.
+static inline auto dispatch(uint64_t index, size_t readers, dispatch_policy policy) -> size_t {
+    if (policy == dispatch_policy::round_robin)
+        return index % readers;
+    uint64_t key = index + 0x9E3779B97F4A7C15;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EB;
+    return (key ^ (key >> 31)) % readers;
+}
+
+static inline auto channel_writer(const std::vector<int> &queues, const size_t readers, const dispatch_policy policy,
+                                  channel_control *const control) -> void {
+    channel_message *msg = new channel_message;
+    auto send = [&](size_t reader) {
+        const bool shared = queues.size() == 1;
+        msg->msg_type = shared ? static_cast<long>(reader + 1) : message_type;
+        if (msgsnd(shared ? queues[0] : queues[reader], msg, channel_payload, 0) == -1) {
+            perror("msgsnd");
+            exit(EXIT_FAILURE);
+        }
+    };
+
+    control->start_ns = monotonic_ns();
+    for (size_t i = 0; i < channel_round; ++i) {
+        msg->index = i;
+        msg->data.generate(generating_seed + i);
+        msg->generated_ns = monotonic_ns();
+        send(dispatch(i, readers, policy));
+    }
+    msg->index = channel_stop;
+    for (size_t reader = 0; reader < readers; ++reader)
+        send(reader);
+    delete msg;
+}
+
+static inline auto channel_reader(const int msgid, const long type, channel_reader_statistics *const stats) -> void {
+    channel_message *msg = new channel_message;
+    [[maybe_unused]] frame *expected_frame = new frame;
+    channel_reader_statistics result{};
+
+    while (true) {
+        if (msgrcv(msgid, msg, channel_payload, type, 0) == -1) {
+            perror("msgrcv");
+            exit(EXIT_FAILURE);
+        }
+        if (msg->index == channel_stop)
+            break;
+        result.latency_ns += monotonic_ns() - msg->generated_ns;
+        ++result.frames;
+
+#ifdef FRAME_CHECK
+        expected_frame->generate(generating_seed + msg->index);
+        if (!(msg->data == *expected_frame))
+            std::cerr << std::format("Data mismatch at round {}", msg->index) << std::endl;
+#endif
+    }
+    result.finished_ns = monotonic_ns();
+    *stats = result;
+    delete msg;
+    delete expected_frame;
+}
+
+// One writer feeding M readers, either through one queue with a msg_type
+// per reader or through a queue per reader. Fairness is Jain's index over
+// the readers' frame rates: 1 when all are equal, 1 / M when one reader
+// gets everything.
+static inline auto run_channels(const size_t readers, const dispatch_policy policy, const bool shared_queue) -> void {
+    std::vector<int> queues(shared_queue ? 1 : readers);
+    for (int &msgid : queues) {
+        msgid = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+        if (msgid == -1) {
+            perror("msgget");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    void *shared_memory = mmap(nullptr, sizeof(channel_control), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared_memory == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    channel_control *control = new (shared_memory) channel_control{};
+
+    std::vector<pid_t> pids;
+    std::cout << std::flush;
+    for (size_t reader = 0; reader < readers; ++reader) {
+        auto pid = fork();
+        if (pid == -1) {
+            perror("fork");
+            exit(EXIT_FAILURE);
+        }
+        if (pid == 0) {
+            if (shared_queue)
+                channel_reader(queues[0], reader + 1, &control->readers[reader]);
+            else
+                channel_reader(queues[reader], message_type, &control->readers[reader]);
+            exit(EXIT_SUCCESS);
+        }
+        pids.push_back(pid);
+    }
+
+    channel_writer(queues, readers, policy, control);
+    for (auto pid : pids)
+        waitpid(pid, nullptr, 0);
+
+    uint64_t frames = 0, finished = control->start_ns;
+    uint64_t fewest = UINT64_MAX, most = 0;
+    double rate_sum = 0, rate_square_sum = 0, slowest = 1e300, fastest = 0;
+    double best_latency = 1e300, worst_latency = 0;
+    for (size_t reader = 0; reader < readers; ++reader) {
+        const channel_reader_statistics &stats = control->readers[reader];
+        const double rate = stats.frames / ((stats.finished_ns - control->start_ns) / 1e9);
+        const double latency = stats.frames ? stats.latency_ns / 1e3 / stats.frames : 0;
+        frames += stats.frames;
+        finished = std::max(finished, stats.finished_ns);
+        fewest = std::min(fewest, stats.frames);
+        most = std::max(most, stats.frames);
+        rate_sum += rate;
+        rate_square_sum += rate * rate;
+        slowest = std::min(slowest, rate);
+        fastest = std::max(fastest, rate);
+        best_latency = std::min(best_latency, latency);
+        worst_latency = std::max(worst_latency, latency);
+    }
+    if (frames != channel_round)
+        std::cerr << std::format("Readers received {} of {} frames", frames, channel_round) << std::endl;
+
+    const double elapsed = (finished - control->start_ns) / 1e9;
+    std::cout
+        << std::format("{}, M = {}, {}: {} frames/s, {} MiB/s, frames per reader {}..{}, "
+                       "reader rate {}..{} frames/s, Jain fairness {:.4f}, mean latency {}..{} us",
+                       shared_queue ? "one queue" : "M queues", readers,
+                       policy == dispatch_policy::round_robin ? "round robin" : "hashed",
+                       frames / elapsed, frames * message_size / (1024.0 * 1024.0) / elapsed, fewest, most,
+                       slowest, fastest, rate_sum * rate_sum / (readers * rate_square_sum), best_latency, worst_latency)
+        << std::endl;
+
+    munmap(shared_memory, sizeof(channel_control));
+    for (int msgid : queues)
+        if (msgctl(msgid, IPC_RMID, nullptr) == -1) {
+            perror("msgctl");
+            exit(EXIT_FAILURE);
+        }
+}
+
+static inline auto channels(const size_t requested, const std::string_view policy_name) -> void {
+    std::vector<size_t> reader_counts(std::begin(channel_reader_counts), std::end(channel_reader_counts));
+    if (requested)
+        reader_counts = {requested};
+    std::vector<dispatch_policy> policies{dispatch_policy::round_robin, dispatch_policy::hash};
+    if (policy_name == "rr")
+        policies = {dispatch_policy::round_robin};
+    else if (policy_name == "hash")
+        policies = {dispatch_policy::hash};
+
+    for (size_t readers : reader_counts)
+        for (dispatch_policy policy : policies)
+            for (bool shared_queue : {true, false})
+                run_channels(readers, policy, shared_queue);
+}
+
+static inline auto parse_count(std::string_view text, size_t &value) -> bool {
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && ptr == text.data() + text.size();
+}
+
+int main(int argc, char *argv[]) {
+    std::string mode = argc > 1 ? argv[1] : "stream";
+
+    if (mode == "batch") {
+        size_t batch_size = 0;
+        if (argc > 2 && (!parse_count(argv[2], batch_size) || batch_size == 0)) {
+            std::cerr << std::format("Usage: {} batch [K (at least 1)]", argv[0]) << std::endl;
+            return EXIT_FAILURE;
+        }
+        batch(batch_size);
+        return 0;
+    }
+
+    if (mode == "fragment") {
+        constexpr size_t largest_frame = *std::max_element(std::begin(fragment_frame_sizes), std::end(fragment_frame_sizes));
+        size_t frame_size = 0;
+        if (argc > 2 && (!parse_count(argv[2], frame_size) || frame_size == 0 || frame_size > largest_frame)) {
+            std::cerr << std::format("Usage: {} fragment [frame size (1 to {} B)]", argv[0], largest_frame) << std::endl;
+            return EXIT_FAILURE;
+        }
+        fragment(frame_size);
+        return 0;
+    }
+
+    if (mode == "channels") {
+        size_t readers = 0;
+        std::string_view policy = argc > 3 ? argv[3] : "";
+        if ((argc > 2 && !parse_count(argv[2], readers)) || readers > channel_max_readers || (!policy.empty() && policy != "rr" && policy != "hash")) {
+            std::cerr << std::format("Usage: {} channels [readers (at most {})] [rr|hash]", argv[0], channel_max_readers) << std::endl;
+            return EXIT_FAILURE;
+        }
+        channels(readers, policy);
+        return 0;
+    }
+
+    if (mode != "stream") {
+        std::cerr << std::format("Usage: {} [stream|batch [K]|fragment [frame size]|channels [M] [rr|hash]]", argv[0]) << std::endl;
+        return EXIT_FAILURE;
+    }
+
     key_t key = IPC_PRIVATE;
 
     int msgid = msgget(key, IPC_CREAT | 0600);
@@ -1,28 +1,128 @@
+#include "mpmc_queue.hpp"
+#include "seqlock.hpp"
 #include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <chrono>
 #include <cstring>
+#include <format>
 #include <iostream>
+#include <limits>
+#include <linux/futex.h>
+#include <new>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <string_view>
+#include <sys/resource.h>
 #include <sys/sem.h>
 #include <sys/shm.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <vector>
 
 constexpr size_t message_size = 1 << 20;
 constexpr size_t interval = 1e4;
 constexpr size_t round = 1e5;
 constexpr uint64_t generating_seed = 2022212720;
+constexpr size_t cache_line_size = 64;
+constexpr size_t ring_slot_counts[] = {1, 2, 4, 8, 16};
+constexpr size_t sync_frame_sizes[] = {64, 1 << 10, 1 << 12, 1 << 16, 1 << 20};
+constexpr uint32_t adaptive_spin_budget = 1000;
+constexpr size_t mpmc_round = 1e6;
+constexpr size_t mpmc_capacity = 1 << 10;
+constexpr size_t mpmc_process_counts[] = {1, 2, 4, 8};
+constexpr size_t mpmc_max_processes = 64;
+constexpr size_t broadcast_round = 1e6;
+constexpr size_t broadcast_slot_counts[] = {1, 8};
+constexpr size_t broadcast_reader_counts[] = {1, 2, 4, 8};
+constexpr size_t broadcast_max_readers = 64;
 
 struct frame {
     std::byte data[message_size];
     auto operator==(const frame &another) const -> bool {
-        return std::memcmp(data, another.data, message_size) == 0;
+        return equals(another, message_size);
     }
-    auto generate(uint64_t seed) -> void {
-        std::fill(data, data + message_size, static_cast<std::byte>(seed));
+    auto equals(const frame &another, size_t size) const -> bool {
+        return std::memcmp(data, another.data, size) == 0;
+    }
+    auto generate(uint64_t seed, size_t size = message_size) -> void {
+        std::fill(data, data + size, static_cast<std::byte>(seed));
+    }
+    auto digest() const -> uint64_t {
+        uint64_t result = 0;
+        for (size_t i = 0; i < message_size; i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            result ^= word;
+        }
+        return result;
+    }
+};
+
+enum class consume_mode {
+    copy,
+    lease,
+};
+
+struct alignas(cache_line_size) ring_index {
+    std::atomic<uint64_t> value;
+};
+
+struct ring_header {
+    ring_index head; // frames published by the writer
+    ring_index tail; // frames released by the reader
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+static inline auto ring_slot(ring_header *const header, size_t slot) -> frame * {
+    return reinterpret_cast<frame *>(reinterpret_cast<std::byte *>(header) + sizeof(ring_header)) + slot;
+}
+
+// Writer side of the ring: claim() hands out the next free slot and
+// publish() makes it visible to the reader.
+struct ring_producer {
+    ring_header *header;
+    size_t slots;
+    uint64_t next = 0;
+    uint64_t cached_tail = 0;
+
+    auto claim() -> frame * {
+        while (next - cached_tail == slots) {
+            sched_yield();
+            cached_tail = header->tail.value.load(std::memory_order_acquire);
+        }
+        return ring_slot(header, next % slots);
+    }
+    auto publish() -> void {
+        header->head.value.store(++next, std::memory_order_release);
+    }
+};
+
+// Reader side of the ring: lease() waits for the next published frame and
+// returns it in place, release() hands the slot back to the writer.
+struct ring_consumer {
+    ring_header *header;
+    size_t slots;
+    uint64_t next = 0;
+    uint64_t cached_head = 0;
+
+    auto lease() -> const frame * {
+        while (cached_head == next) {
+            sched_yield();
+            cached_head = header->head.value.load(std::memory_order_acquire);
+        }
+        return ring_slot(header, next % slots);
+    }
+    auto release() -> void {
+        header->tail.value.store(++next, std::memory_order_release);
     }
 };
 
 struct sembuf sem_op;
+size_t sync_syscalls = 0;
 
 static inline auto init_semaphore(int semid, int val) -> void {
     if (semctl(semid, 0, SETVAL, val) == -1) {
@@ -35,6 +135,7 @@ static inline auto sem_p(int semid) -> void {
     sem_op.sem_num = 0;
     sem_op.sem_op = -1;
     sem_op.sem_flg = 0;
+    ++sync_syscalls;
     if (semop(semid, &sem_op, 1) == -1) {
         perror("semop P");
         exit(EXIT_FAILURE);
@@ -45,19 +146,290 @@ static inline auto sem_v(int semid) -> void {
     sem_op.sem_num = 0;
     sem_op.sem_op = 1;
     sem_op.sem_flg = 0;
+    ++sync_syscalls;
     if (semop(semid, &sem_op, 1) == -1) {
         perror("semop V");
         exit(EXIT_FAILURE);
     }
 }
 
-static inline auto writer(const int read_semid, const int write_semid, frame *const shared_frame) -> void {
+// Every back-end tells whether sync_syscalls sees all of its system calls;
+// the pthread one makes its futex calls inside glibc.
+struct sysv_semaphore {
+    static constexpr bool counts_syscalls = true;
+    int semid;
+    auto p() -> void { sem_p(semid); }
+    auto v() -> void { sem_v(semid); }
+};
+
+static inline auto futex(std::atomic<uint32_t> *addr, int op, uint32_t val) -> long {
+    ++sync_syscalls;
+    return syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), op, val, nullptr, nullptr, 0);
+}
+
+static inline auto cpu_relax() -> void {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Counting semaphore living in the shared segment. P and V stay in userspace
+// unless the count is zero or the other side is sleeping on it.
+struct alignas(cache_line_size) futex_semaphore {
+    static constexpr bool counts_syscalls = true;
+    std::atomic<uint32_t> value;
+    std::atomic<uint32_t> waiters;
+
+    explicit futex_semaphore(uint32_t value) : value(value), waiters(0) {}
+
+    auto try_p() -> bool {
+        uint32_t current = value.load(std::memory_order_relaxed);
+        while (current > 0)
+            if (value.compare_exchange_weak(current, current - 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+        return false;
+    }
+
+    auto p() -> void {
+        while (!try_p()) {
+            waiters.fetch_add(1, std::memory_order_seq_cst);
+            if (futex(&value, FUTEX_WAIT, 0) == -1 && errno != EAGAIN && errno != EINTR) {
+                perror("futex wait");
+                exit(EXIT_FAILURE);
+            }
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    auto v() -> void {
+        value.fetch_add(1, std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_seq_cst) > 0 && futex(&value, FUTEX_WAKE, 1) == -1) {
+            perror("futex wake");
+            exit(EXIT_FAILURE);
+        }
+    }
+};
+
+// Spins up to spin_budget pause instructions before sleeping on the futex.
+// A hand-off that lands within the budget never enters the kernel on either
+// side, since V only wakes when somebody is registered as waiting.
+struct adaptive_semaphore : futex_semaphore {
+    uint32_t spin_budget;
+
+    adaptive_semaphore(uint32_t value, uint32_t spin_budget) : futex_semaphore(value), spin_budget(spin_budget) {}
+
+    auto p() -> void {
+        for (uint32_t i = 0; i < spin_budget; ++i) {
+            if (try_p())
+                return;
+            cpu_relax();
+        }
+        futex_semaphore::p();
+    }
+};
+
+// Never blocks: the waiting side burns its CPU until the count moves. Only
+// sensible when writer and reader each have a core of their own.
+struct alignas(cache_line_size) spin_semaphore {
+    static constexpr bool counts_syscalls = true;
+    std::atomic<uint32_t> value;
+
+    explicit spin_semaphore(uint32_t value) : value(value) {}
+
+    auto p() -> void {
+        while (true) {
+            uint32_t current = value.load(std::memory_order_relaxed);
+            if (current > 0 && value.compare_exchange_weak(current, current - 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+            cpu_relax();
+        }
+    }
+
+    auto v() -> void { value.fetch_add(1, std::memory_order_release); }
+};
+
+static inline auto check_pthread(int error, const char *what) -> void {
+    if (error != 0) {
+        errno = error;
+        perror(what);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Counting semaphore from a PTHREAD_PROCESS_SHARED mutex and condition
+// variable, as a portable program without raw futexes would build it.
+struct alignas(cache_line_size) pthread_semaphore {
+    static constexpr bool counts_syscalls = false;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint32_t value;
+
+    explicit pthread_semaphore(uint32_t value) : value(value) {
+        pthread_mutexattr_t mutex_attr;
+        check_pthread(pthread_mutexattr_init(&mutex_attr), "pthread_mutexattr_init");
+        check_pthread(pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED), "pthread_mutexattr_setpshared");
+        check_pthread(pthread_mutex_init(&mutex, &mutex_attr), "pthread_mutex_init");
+        pthread_mutexattr_destroy(&mutex_attr);
+
+        pthread_condattr_t cond_attr;
+        check_pthread(pthread_condattr_init(&cond_attr), "pthread_condattr_init");
+        check_pthread(pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED), "pthread_condattr_setpshared");
+        check_pthread(pthread_cond_init(&cond, &cond_attr), "pthread_cond_init");
+        pthread_condattr_destroy(&cond_attr);
+    }
+
+    ~pthread_semaphore() {
+        pthread_cond_destroy(&cond);
+        pthread_mutex_destroy(&mutex);
+    }
+
+    auto p() -> void {
+        check_pthread(pthread_mutex_lock(&mutex), "pthread_mutex_lock");
+        while (value == 0)
+            check_pthread(pthread_cond_wait(&cond, &mutex), "pthread_cond_wait");
+        --value;
+        check_pthread(pthread_mutex_unlock(&mutex), "pthread_mutex_unlock");
+    }
+
+    auto v() -> void {
+        check_pthread(pthread_mutex_lock(&mutex), "pthread_mutex_lock");
+        ++value;
+        check_pthread(pthread_mutex_unlock(&mutex), "pthread_mutex_unlock");
+        check_pthread(pthread_cond_signal(&cond), "pthread_cond_signal");
+    }
+};
+
+// Both semaphores of a ping-pong plus the writer's timestamp of the last
+// hand-off, all in the shared segment right before the frame.
+template <typename semaphore_t>
+struct semaphore_channel {
+    semaphore_t write_sem;
+    semaphore_t read_sem;
+    uint64_t sent_at = 0;
+
+    template <typename... args_t>
+    explicit semaphore_channel(const args_t &...args) : write_sem(1, args...), read_sem(0, args...) {}
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+struct cpu_usage {
+    double seconds;          // user + system
+    long voluntary_switches; // times the process went to sleep
+
+    static auto now() -> cpu_usage {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return {usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6,
+                usage.ru_nvcsw};
+    }
+};
+
+// Both processes read CLOCK_MONOTONIC, so a stamp taken by the writer can be
+// compared with the reader's clock.
+static inline auto monotonic_ns() -> uint64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename semaphore_t>
+static inline auto sync_summary(const size_t frame_size, const double elapsed, const cpu_usage &start_cpu) -> std::string {
+    cpu_usage end_cpu = cpu_usage::now();
+    double cpu = end_cpu.seconds - start_cpu.seconds;
+    std::string syscalls = semaphore_t::counts_syscalls ? std::format("{}", static_cast<double>(sync_syscalls) / round) : "n/a";
+    return std::format("total speed with {} B frames: {} MiB/s, {} frames/s, {} sync syscalls/frame, "
+                       "CPU {:.1f}% of wall time ({} us/frame), {} sleeps/frame",
+                       frame_size, round * frame_size / (1024.0 * 1024.0) / elapsed, round / elapsed, syscalls,
+                       100 * cpu / elapsed, cpu * 1e6 / round,
+                       static_cast<double>(end_cpu.voluntary_switches - start_cpu.voluntary_switches) / round);
+}
+
+template <typename semaphore_t>
+static inline auto writer(semaphore_t *const read_sem, semaphore_t *const write_sem, frame *const shared_frame, uint64_t *const sent_at,
+                          const size_t frame_size) -> void {
+    sync_syscalls = 0;
+    cpu_usage start_cpu = cpu_usage::now();
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    for (size_t i = 0; i < round; ++i) {
+        write_sem->p();
+        shared_frame->generate(generating_seed + i, frame_size);
+        *sent_at = monotonic_ns();
+        read_sem->v();
+
+        if ((i + 1) % interval == 0) {
+            auto current_time = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> elapsed = current_time - start_time;
+            double speed = (i + 1) * frame_size / (1024.0 * 1024.0) / elapsed.count();
+            std::cout
+                << std::format("Writer processed {} frames at speed: {} MiB/s", i + 1, speed)
+                << std::endl;
+        }
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> total_elapsed = end_time - start_time;
+
+    std::cout << "Writer " << sync_summary<semaphore_t>(frame_size, total_elapsed.count(), start_cpu) << std::endl;
+}
+
+// The hand-off latency of a frame runs from the writer's V to the moment the
+// reader's P returns with it.
+template <typename semaphore_t>
+static inline auto reader(semaphore_t *const read_sem, semaphore_t *const write_sem, frame *const shared_frame, uint64_t *const sent_at,
+                          const size_t frame_size) -> void {
+    frame *local_frame = new frame;
+    frame *expected_frame = new frame;
+    std::vector<uint64_t> latencies(round);
+    sync_syscalls = 0;
+    cpu_usage start_cpu = cpu_usage::now();
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    for (size_t i = 0; i < round; ++i) {
+        read_sem->p();
+        latencies[i] = monotonic_ns() - *sent_at;
+        std::memcpy(local_frame->data, shared_frame->data, frame_size);
+        write_sem->v();
+
+#ifdef FRAME_CHECK
+        expected_frame->generate(generating_seed + i, frame_size);
+        if (!local_frame->equals(*expected_frame, frame_size))
+            std::cerr << std::format("Data mismatch at round {}", i) << std::endl;
+#endif
+
+        if ((i + 1) % interval == 0) {
+            auto current_time = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> elapsed = current_time - start_time;
+            double speed = (i + 1) * frame_size / (1024.0 * 1024.0) / elapsed.count();
+            std::cout
+                << std::format("Reader processed {} frames at speed: {} MiB/s", i + 1, speed)
+                << std::endl;
+        }
+    }
+    delete local_frame;
+    delete expected_frame;
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> total_elapsed = end_time - start_time;
+    std::string summary = sync_summary<semaphore_t>(frame_size, total_elapsed.count(), start_cpu);
+
+    uint64_t total_latency = 0;
+    for (uint64_t latency : latencies)
+        total_latency += latency;
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "Reader " << summary << std::endl;
+    std::cout
+        << std::format("Hand-off latency with {} B frames: mean {} ns, p50 {} ns, p99 {} ns, max {} ns",
+                       frame_size, total_latency / round, latencies[round / 2], latencies[round * 99 / 100], latencies.back())
+        << std::endl;
+}
+
+static inline auto ring_writer(ring_header *const header, const size_t slots) -> void {
+    ring_producer producer{header, slots};
     auto start_time = std::chrono::high_resolution_clock::now();
 
     for (size_t i = 0; i < round; ++i) {
-        sem_p(write_semid);
-        shared_frame->generate(generating_seed + i);
-        sem_v(read_semid);
+        producer.claim()->generate(generating_seed + i);
+        producer.publish();
 
         if ((i + 1) % interval == 0) {
             auto current_time = std::chrono::high_resolution_clock::now();
@@ -73,25 +445,37 @@ static inline auto writer(const int read_semid, const int write_semid, frame *co
     std::chrono::duration<double> total_elapsed = end_time - start_time;
     double total_speed = round * message_size / (1024.0 * 1024.0) / total_elapsed.count();
 
-    std::cout << std::format("Writer total speed: {} MiB/s", total_speed) << std::endl;
+    std::cout << std::format("Writer total speed with {} slots: {} MiB/s", slots, total_speed) << std::endl;
 }
 
-static inline auto reader(const int read_semid, const int write_semid, frame *const shared_frame) -> void {
+static inline auto ring_reader(ring_header *const header, const size_t slots, const consume_mode mode) -> void {
     frame *local_frame = new frame;
     frame *expected_frame = new frame;
+    ring_consumer consumer{header, slots};
+    [[maybe_unused]] volatile uint64_t digest_sink = 0;
     auto start_time = std::chrono::high_resolution_clock::now();
 
     for (size_t i = 0; i < round; ++i) {
-        sem_p(read_semid);
-        *local_frame = *shared_frame;
-        sem_v(write_semid);
+        const frame *shared_frame = consumer.lease();
+        const frame *received_frame = shared_frame;
+        if (mode == consume_mode::copy) {
+            *local_frame = *shared_frame;
+            consumer.release();
+            received_frame = local_frame;
+        }
 
 #ifdef FRAME_CHECK
         expected_frame->generate(generating_seed + i);
-        if (!(*local_frame == *expected_frame))
+        if (!(*received_frame == *expected_frame))
             std::cerr << std::format("Data mismatch at round {}", i) << std::endl;
+#else
+        if (mode == consume_mode::lease)
+            digest_sink = digest_sink ^ received_frame->digest();
 #endif
 
+        if (mode == consume_mode::lease)
+            consumer.release();
+
         if ((i + 1) % interval == 0) {
             auto current_time = std::chrono::high_resolution_clock::now();
             std::chrono::duration<double> elapsed = current_time - start_time;
@@ -108,10 +492,33 @@ static inline auto reader(const int read_semid, const int write_semid, frame *co
     std::chrono::duration<double> total_elapsed = end_time - start_time;
     double total_speed = round * message_size / (1024.0 * 1024.0) / total_elapsed.count();
 
-    std::cout << std::format("Reader total speed: {} MiB/s", total_speed) << std::endl;
+    std::cout
+        << std::format("Reader total speed with {} slots ({}): {} MiB/s",
+                       slots, mode == consume_mode::copy ? "copy" : "lease", total_speed)
+        << std::endl;
 }
 
-int main() {
+static inline auto measure_copy_bandwidth() -> void {
+    frame *source_frame = new frame;
+    frame *target_frame = new frame;
+    source_frame->generate(generating_seed);
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    for (size_t i = 0; i < round; ++i) {
+        *target_frame = *source_frame;
+        asm volatile("" : : "r"(target_frame) : "memory");
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> total_elapsed = end_time - start_time;
+    double total_speed = round * message_size / (1024.0 * 1024.0) / total_elapsed.count();
+    delete source_frame;
+    delete target_frame;
+
+    std::cout << std::format("Local frame copy speed: {} MiB/s", total_speed) << std::endl;
+}
+
+static inline auto run_pingpong(const size_t frame_size) -> void {
     key_t key = IPC_PRIVATE;
 
     int shmid = shmget(key, sizeof(frame) + sizeof(uint64_t), IPC_CREAT | 0600);
@@ -141,20 +548,472 @@ int main() {
     init_semaphore(write_semid, 1);
     init_semaphore(read_semid, 0);
     frame *shared_frame = static_cast<frame *>(shared_memory);
+    uint64_t *sent_at = reinterpret_cast<uint64_t *>(shared_frame + 1);
+    sysv_semaphore write_sem{write_semid}, read_sem{read_semid};
 
+    std::cout << std::flush;
     auto pid = fork();
     if (pid) {
-        writer(read_semid, write_semid, shared_frame);
+        writer(&read_sem, &write_sem, shared_frame, sent_at, frame_size);
         wait(nullptr);
     } else
-        reader(read_semid, write_semid, shared_frame);
+        reader(&read_sem, &write_sem, shared_frame, sent_at, frame_size);
 
     shmdt(shared_memory);
     if (pid) {
         shmctl(shmid, IPC_RMID, nullptr);
         semctl(write_semid, 0, IPC_RMID);
         semctl(read_semid, 0, IPC_RMID);
+    } else
+        exit(EXIT_SUCCESS);
+}
+
+// Ping-pong over semaphores that live in the shared segment itself; args are
+// passed to every semaphore after its initial count.
+template <typename semaphore_t, typename... args_t>
+static inline auto run_shared_pingpong(const size_t frame_size, const args_t &...args) -> void {
+    using channel_t = semaphore_channel<semaphore_t>;
+    int shmid = shmget(IPC_PRIVATE, sizeof(channel_t) + sizeof(frame), IPC_CREAT | 0600);
+    if (shmid == -1) {
+        perror("shmget");
+        exit(EXIT_FAILURE);
     }
 
+    void *shared_memory = shmat(shmid, nullptr, 0);
+    if (shared_memory == (void *)-1) {
+        perror("shmat");
+        exit(EXIT_FAILURE);
+    }
+
+    channel_t *channel = new (shared_memory) channel_t(args...);
+    frame *shared_frame = reinterpret_cast<frame *>(channel + 1);
+
+    std::cout << std::flush;
+    auto pid = fork();
+    if (pid) {
+        writer(&channel->read_sem, &channel->write_sem, shared_frame, &channel->sent_at, frame_size);
+        wait(nullptr);
+        channel->~channel_t();
+    } else
+        reader(&channel->read_sem, &channel->write_sem, shared_frame, &channel->sent_at, frame_size);
+
+    shmdt(shared_memory);
+    if (pid)
+        shmctl(shmid, IPC_RMID, nullptr);
+    else
+        exit(EXIT_SUCCESS);
+}
+
+// With a single CPU the spinning side holds it until its time slice runs
+// out, so every hand-off costs a full scheduler tick.
+static inline auto spinning_is_useful() -> bool {
+    return sysconf(_SC_NPROCESSORS_ONLN) > 1;
+}
+
+static inline auto run_ring(const size_t slots, const consume_mode mode) -> void {
+    int shmid = shmget(IPC_PRIVATE, sizeof(ring_header) + slots * sizeof(frame), IPC_CREAT | 0600);
+    if (shmid == -1) {
+        perror("shmget");
+        exit(EXIT_FAILURE);
+    }
+
+    void *shared_memory = shmat(shmid, nullptr, 0);
+    if (shared_memory == (void *)-1) {
+        perror("shmat");
+        exit(EXIT_FAILURE);
+    }
+
+    ring_header *header = new (shared_memory) ring_header{};
+
+    auto pid = fork();
+    if (pid) {
+        ring_writer(header, slots);
+        wait(nullptr);
+    } else
+        ring_reader(header, slots, mode);
+
+    shmdt(shared_memory);
+    if (pid)
+        shmctl(shmid, IPC_RMID, nullptr);
+    else
+        exit(EXIT_SUCCESS);
+}
+
+struct mpmc_frame_header {
+    uint32_t writer;
+    uint32_t stop;
+    uint64_t index;
+};
+
+// aligned so the queue placed right after it starts on a cache line
+struct alignas(mpmc_cache_line_size) mpmc_control {
+    std::atomic<uint32_t> started;
+    mpmc_statistics stats[2 * mpmc_max_processes];
+    uint64_t frames[mpmc_max_processes];
+};
+static_assert(sizeof(mpmc_control) % alignof(mpmc_queue) == 0);
+
+static inline auto mpmc_fill(std::byte *payload, uint32_t writer, uint64_t index) -> void {
+    mpmc_frame_header header{writer, 0, index};
+    std::memcpy(payload, &header, sizeof(header));
+    std::fill(payload + sizeof(header), payload + mpmc_payload_size,
+              static_cast<std::byte>(generating_seed + index + writer));
+}
+
+static inline auto mpmc_wait_start(mpmc_control *const control) -> void {
+    while (!control->started.load(std::memory_order_acquire))
+        sched_yield();
+}
+
+static inline auto mpmc_writer(mpmc_queue *const queue, mpmc_control *const control, uint32_t id, size_t frames) -> void {
+    std::byte payload[mpmc_payload_size];
+    mpmc_statistics stats{};
+    mpmc_wait_start(control);
+
+    for (size_t i = 0; i < frames; ++i) {
+        mpmc_fill(payload, id, i);
+        queue->push(payload, stats);
+    }
+
+    control->stats[id] = stats;
+}
+
+static inline auto mpmc_reader(mpmc_queue *const queue, mpmc_control *const control, uint32_t id, size_t writers) -> void {
+    std::byte payload[mpmc_payload_size];
+    [[maybe_unused]] std::byte expected[mpmc_payload_size];
+    mpmc_statistics stats{};
+    uint64_t frames = 0;
+    mpmc_wait_start(control);
+
+    while (true) {
+        queue->pop(payload, stats);
+        mpmc_frame_header header;
+        std::memcpy(&header, payload, sizeof(header));
+        if (header.stop)
+            break;
+
+#ifdef FRAME_CHECK
+        mpmc_fill(expected, header.writer, header.index);
+        if (header.writer >= writers || std::memcmp(payload, expected, mpmc_payload_size) != 0)
+            std::cerr << std::format("Data mismatch at frame {} of writer {}", header.index, header.writer) << std::endl;
+#endif
+        ++frames;
+    }
+
+    control->stats[writers + id] = stats;
+    control->frames[id] = frames;
+}
+
+static inline auto run_mpmc(const size_t writers, const size_t readers) -> void {
+    int shmid = shmget(IPC_PRIVATE, sizeof(mpmc_control) + mpmc_queue::bytes_for(mpmc_capacity), IPC_CREAT | 0600);
+    if (shmid == -1) {
+        perror("shmget");
+        exit(EXIT_FAILURE);
+    }
+
+    void *shared_memory = shmat(shmid, nullptr, 0);
+    if (shared_memory == (void *)-1) {
+        perror("shmat");
+        exit(EXIT_FAILURE);
+    }
+
+    mpmc_control *control = new (shared_memory) mpmc_control{};
+    mpmc_queue *queue = mpmc_queue::create(control + 1, mpmc_capacity);
+
+    std::vector<pid_t> writer_pids, reader_pids;
+    std::cout << std::flush;
+    for (size_t i = 0; i < writers + readers; ++i) {
+        auto pid = fork();
+        if (pid == -1) {
+            perror("fork");
+            exit(EXIT_FAILURE);
+        }
+        if (pid == 0) {
+            if (i < writers)
+                mpmc_writer(queue, control, i, mpmc_round / writers + (i < mpmc_round % writers));
+            else
+                mpmc_reader(queue, control, i - writers, writers);
+            shmdt(shared_memory);
+            exit(EXIT_SUCCESS);
+        }
+        (i < writers ? writer_pids : reader_pids).push_back(pid);
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    control->started.store(1, std::memory_order_release);
+
+    for (auto pid : writer_pids)
+        waitpid(pid, nullptr, 0);
+
+    std::byte stop_payload[mpmc_payload_size]{};
+    mpmc_frame_header stop_header{0, 1, 0};
+    std::memcpy(stop_payload, &stop_header, sizeof(stop_header));
+    mpmc_statistics parent_stats{};
+    for (size_t i = 0; i < readers; ++i)
+        queue->push(stop_payload, parent_stats);
+
+    for (auto pid : reader_pids)
+        waitpid(pid, nullptr, 0);
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    uint64_t retries = 0, waits = 0, received = 0, fewest = UINT64_MAX, most = 0;
+    for (size_t i = 0; i < writers + readers; ++i) {
+        retries += control->stats[i].cas_retries;
+        waits += control->stats[i].waits;
+    }
+    for (size_t i = 0; i < readers; ++i) {
+        received += control->frames[i];
+        fewest = std::min(fewest, control->frames[i]);
+        most = std::max(most, control->frames[i]);
+    }
+    if (received != mpmc_round)
+        std::cerr << std::format("Readers received {} of {} frames", received, mpmc_round) << std::endl;
+
+    std::chrono::duration<double> total_elapsed = end_time - start_time;
+    std::cout
+        << std::format("Writers = {}, readers = {}: {} frames/s, {} MiB/s, {} CAS retries/frame, {} waits/frame, "
+                       "frames per reader {}..{}",
+                       writers, readers, mpmc_round / total_elapsed.count(),
+                       mpmc_round * mpmc_payload_size / (1024.0 * 1024.0) / total_elapsed.count(),
+                       static_cast<double>(retries) / mpmc_round, static_cast<double>(waits) / mpmc_round,
+                       fewest, most)
+        << std::endl;
+
+    shmdt(shared_memory);
+    shmctl(shmid, IPC_RMID, nullptr);
+}
+
+struct broadcast_frame_header {
+    uint64_t index;
+    uint64_t sent_at; // monotonic_ns() when the writer started publishing
+};
+
+struct broadcast_reader_statistics {
+    seqlock_statistics seqlock;
+    uint64_t frames;       // distinct frames read
+    uint64_t freshness_ns; // sum of the frames' ages when read
+    uint64_t max_freshness_ns;
+};
+
+// aligned so the ring placed right after it starts on a cache line
+struct alignas(seqlock_cache_line_size) broadcast_control {
+    std::atomic<uint32_t> started;
+    std::atomic<uint32_t> finished;
+    double writer_seconds;
+    broadcast_reader_statistics readers[broadcast_max_readers];
+};
+static_assert(sizeof(broadcast_control) % alignof(seqlock_ring) == 0);
+
+static inline auto broadcast_fill(std::byte *payload, uint64_t index, uint64_t sent_at) -> void {
+    broadcast_frame_header header{index, sent_at};
+    std::memcpy(payload, &header, sizeof(header));
+    std::fill(payload + sizeof(header), payload + seqlock_payload_size, static_cast<std::byte>(generating_seed + index));
+}
+
+static inline auto broadcast_wait_start(broadcast_control *const control) -> void {
+    while (!control->started.load(std::memory_order_acquire))
+        sched_yield();
+}
+
+static inline auto broadcast_writer(seqlock_ring *const ring, broadcast_control *const control) -> void {
+    std::byte payload[seqlock_payload_size];
+    broadcast_wait_start(control);
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    for (size_t i = 0; i < broadcast_round; ++i) {
+        broadcast_fill(payload, i, monotonic_ns());
+        ring->publish(i, payload);
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start_time;
+    control->writer_seconds = elapsed.count();
+    control->finished.store(1, std::memory_order_release);
+}
+
+// Polls for the latest frame until the writer is done. Frames published
+// between two polls are skipped, which is the point of a broadcast slot.
+static inline auto broadcast_reader(seqlock_ring *const ring, broadcast_control *const control, uint32_t id) -> void {
+    std::byte payload[seqlock_payload_size];
+    [[maybe_unused]] std::byte expected[seqlock_payload_size];
+    broadcast_reader_statistics stats{};
+    uint64_t seen = 0;
+    broadcast_wait_start(control);
+
+    while (true) {
+        bool finished = control->finished.load(std::memory_order_acquire);
+        uint64_t latest = ring->read_latest(seen, payload, stats.seqlock);
+        if (latest == seen) {
+            if (finished)
+                break;
+            sched_yield();
+            continue;
+        }
+        seen = latest;
+
+        broadcast_frame_header header;
+        std::memcpy(&header, payload, sizeof(header));
+        uint64_t freshness = monotonic_ns() - header.sent_at;
+        stats.freshness_ns += freshness;
+        stats.max_freshness_ns = std::max(stats.max_freshness_ns, freshness);
+        ++stats.frames;
+
+#ifdef FRAME_CHECK
+        broadcast_fill(expected, latest - 1, header.sent_at);
+        if (std::memcmp(payload, expected, seqlock_payload_size) != 0)
+            std::cerr << std::format("Data mismatch at frame {}", latest - 1) << std::endl;
+#endif
+    }
+
+    control->readers[id] = stats;
+}
+
+static inline auto run_broadcast(const size_t slots, const size_t readers) -> void {
+    int shmid = shmget(IPC_PRIVATE, sizeof(broadcast_control) + seqlock_ring::bytes_for(slots), IPC_CREAT | 0600);
+    if (shmid == -1) {
+        perror("shmget");
+        exit(EXIT_FAILURE);
+    }
+
+    void *shared_memory = shmat(shmid, nullptr, 0);
+    if (shared_memory == (void *)-1) {
+        perror("shmat");
+        exit(EXIT_FAILURE);
+    }
+
+    broadcast_control *control = new (shared_memory) broadcast_control{};
+    seqlock_ring *ring = seqlock_ring::create(control + 1, slots);
+
+    std::vector<pid_t> pids;
+    std::cout << std::flush;
+    for (size_t i = 0; i <= readers; ++i) {
+        auto pid = fork();
+        if (pid == -1) {
+            perror("fork");
+            exit(EXIT_FAILURE);
+        }
+        if (pid == 0) {
+            if (i == 0)
+                broadcast_writer(ring, control);
+            else
+                broadcast_reader(ring, control, i - 1);
+            shmdt(shared_memory);
+            exit(EXIT_SUCCESS);
+        }
+        pids.push_back(pid);
+    }
+
+    control->started.store(1, std::memory_order_release);
+    for (auto pid : pids)
+        waitpid(pid, nullptr, 0);
+
+    uint64_t frames = 0, retries = 0, polls = 0, freshness = 0, max_freshness = 0;
+    for (size_t i = 0; i < readers; ++i) {
+        const broadcast_reader_statistics &stats = control->readers[i];
+        frames += stats.frames;
+        retries += stats.seqlock.retries;
+        polls += stats.seqlock.polls;
+        freshness += stats.freshness_ns;
+        max_freshness = std::max(max_freshness, stats.max_freshness_ns);
+    }
+    frames = std::max<uint64_t>(frames, 1);
+
+    std::cout
+        << std::format("Slots = {}, readers = {}: writer {} frames/s, readers saw {:.2f}% of frames, "
+                       "{} retries/frame read, {} empty polls/frame read, freshness mean {} ns, max {} ns",
+                       slots, readers, broadcast_round / control->writer_seconds,
+                       100.0 * frames / (readers * broadcast_round), static_cast<double>(retries) / frames,
+                       static_cast<double>(polls) / frames, freshness / frames, max_freshness)
+        << std::endl;
+
+    shmdt(shared_memory);
+    shmctl(shmid, IPC_RMID, nullptr);
+}
+
+static inline auto parse_count(std::string_view text, size_t &value) -> bool {
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && ptr == text.data() + text.size();
+}
+
+static inline auto usage(const char *program) -> int {
+    std::cerr << std::format("Usage: {} [pingpong [sysv|futex|pthread|spin|adaptive [spin budget]]|sync|ring [copy|lease]|"
+                             "mpmc [writers readers]|broadcast [readers]]",
+                             program)
+              << std::endl;
+    return EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[]) {
+    std::string_view mode = argc > 1 ? argv[1] : "pingpong";
+    std::string_view option = argc > 2 ? argv[2] : "";
+
+    if (mode == "pingpong" && (option.empty() || option == "sysv"))
+        run_pingpong(message_size);
+    else if (mode == "pingpong" && option == "futex")
+        run_shared_pingpong<futex_semaphore>(message_size);
+    else if (mode == "pingpong" && option == "pthread")
+        run_shared_pingpong<pthread_semaphore>(message_size);
+    else if (mode == "pingpong" && option == "spin") {
+        if (!spinning_is_useful())
+            std::cerr << "Only one CPU is online: every spin hand-off waits for the scheduler" << std::endl;
+        run_shared_pingpong<spin_semaphore>(message_size);
+    } else if (mode == "pingpong" && option == "adaptive") {
+        size_t budget = adaptive_spin_budget;
+        if (argc > 3 && (!parse_count(argv[3], budget) || budget > std::numeric_limits<uint32_t>::max()))
+            return usage(argv[0]);
+        std::cout << std::format("Adaptive semaphores spinning {} times before blocking", budget) << std::endl;
+        run_shared_pingpong<adaptive_semaphore>(message_size, static_cast<uint32_t>(budget));
+    } else if (mode == "sync") {
+        for (size_t frame_size : sync_frame_sizes) {
+            std::cout << std::format("SysV semaphores, {} B frames", frame_size) << std::endl;
+            run_pingpong(frame_size);
+            std::cout << std::format("Futex semaphores, {} B frames", frame_size) << std::endl;
+            run_shared_pingpong<futex_semaphore>(frame_size);
+            std::cout << std::format("Pthread mutex and condition variable, {} B frames", frame_size) << std::endl;
+            run_shared_pingpong<pthread_semaphore>(frame_size);
+            std::cout << std::format("Adaptive semaphores spinning {} times, {} B frames", adaptive_spin_budget, frame_size) << std::endl;
+            run_shared_pingpong<adaptive_semaphore>(frame_size, adaptive_spin_budget);
+            if (spinning_is_useful()) {
+                std::cout << std::format("Spin semaphores, {} B frames", frame_size) << std::endl;
+                run_shared_pingpong<spin_semaphore>(frame_size);
+            } else
+                std::cout << "Skipping spin semaphores: only one CPU is online" << std::endl;
+        }
+    } else if (mode == "ring") {
+        measure_copy_bandwidth();
+        for (size_t slots : ring_slot_counts) {
+            if (option != "lease")
+                run_ring(slots, consume_mode::copy);
+            if (option != "copy")
+                run_ring(slots, consume_mode::lease);
+        }
+    } else if (mode == "mpmc" && argc > 2) {
+        if (argc < 4)
+            return usage(argv[0]);
+        size_t writers, readers;
+        if (!parse_count(argv[2], writers) || !parse_count(argv[3], readers) || writers == 0 || readers == 0 ||
+            writers > mpmc_max_processes || readers > mpmc_max_processes) {
+            std::cerr << std::format("Writer and reader counts must be between 1 and {}", mpmc_max_processes) << std::endl;
+            return EXIT_FAILURE;
+        }
+        run_mpmc(writers, readers);
+    } else if (mode == "mpmc") {
+        for (size_t writers : mpmc_process_counts)
+            for (size_t readers : mpmc_process_counts)
+                run_mpmc(writers, readers);
+    } else if (mode == "broadcast" && argc > 2) {
+        size_t readers;
+        if (!parse_count(argv[2], readers) || readers == 0 || readers > broadcast_max_readers) {
+            std::cerr << std::format("Reader count must be between 1 and {}", broadcast_max_readers) << std::endl;
+            return EXIT_FAILURE;
+        }
+        for (size_t slots : broadcast_slot_counts)
+            run_broadcast(slots, readers);
+    } else if (mode == "broadcast") {
+        for (size_t slots : broadcast_slot_counts)
+            for (size_t readers : broadcast_reader_counts)
+                run_broadcast(slots, readers);
+    } else
+        return usage(argv[0]);
+
     return 0;
 }
@@ -0,0 +1,103 @@
+#pragma once
+
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <sched.h>
+
+constexpr size_t mpmc_cache_line_size = 64;
+constexpr size_t mpmc_payload_size = 256 - sizeof(uint64_t);
+
+// Bounded multi-producer/multi-consumer queue with sequence-numbered cells
+// (D. Vyukov's design), laid out so that it can be placed in a shared
+// segment and used from several processes. A cell whose sequence equals the
+// enqueue position is free, one whose sequence is one past the dequeue
+// position holds a frame. Producers and consumers only contend on their own
+// position counter.
+struct alignas(mpmc_cache_line_size) mpmc_cell {
+    std::atomic<uint64_t> sequence;
+    std::byte payload[mpmc_payload_size];
+};
+
+struct mpmc_statistics {
+    uint64_t cas_retries; // lost races on the position counter
+    uint64_t waits;       // times the queue was full or empty
+};
+
+struct mpmc_queue {
+    alignas(mpmc_cache_line_size) std::atomic<uint64_t> enqueue_pos;
+    alignas(mpmc_cache_line_size) std::atomic<uint64_t> dequeue_pos;
+    alignas(mpmc_cache_line_size) uint64_t mask;
+
+    static auto bytes_for(size_t capacity) -> size_t {
+        return sizeof(mpmc_queue) + capacity * sizeof(mpmc_cell);
+    }
+
+    // capacity must be a power of two
+    static auto create(void *memory, size_t capacity) -> mpmc_queue * {
+        mpmc_queue *queue = new (memory) mpmc_queue;
+        queue->enqueue_pos.store(0, std::memory_order_relaxed);
+        queue->dequeue_pos.store(0, std::memory_order_relaxed);
+        queue->mask = capacity - 1;
+        for (size_t i = 0; i < capacity; ++i)
+            new (&queue->cells()[i]) mpmc_cell{{i}, {}};
+        return queue;
+    }
+
+    auto cells() -> mpmc_cell * {
+        return reinterpret_cast<mpmc_cell *>(this + 1);
+    }
+
+    auto push(const std::byte *payload, mpmc_statistics &stats) -> void {
+        mpmc_cell *cell;
+        uint64_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells()[pos & mask];
+            uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+                ++stats.cas_retries;
+            } else if (diff < 0) {
+                ++stats.waits;
+                sched_yield();
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            } else
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+        std::memcpy(cell->payload, payload, mpmc_payload_size);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+    }
+
+    auto pop(std::byte *payload, mpmc_statistics &stats) -> void {
+        mpmc_cell *cell;
+        uint64_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells()[pos & mask];
+            uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+                ++stats.cas_retries;
+            } else if (diff < 0) {
+                ++stats.waits;
+                sched_yield();
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            } else
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+        }
+        std::memcpy(payload, cell->payload, mpmc_payload_size);
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+    }
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+#endif
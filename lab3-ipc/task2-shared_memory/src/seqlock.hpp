@@ -0,0 +1,95 @@
+#pragma once
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <sched.h>
+
+constexpr size_t seqlock_cache_line_size = 64;
+constexpr size_t seqlock_payload_size = 256 - sizeof(uint64_t);
+constexpr size_t seqlock_yield_after = 1024; // consecutive retries before giving up the CPU
+
+// A slot guarded by a sequence counter: 2 * i + 1 while the writer is
+// copying frame i into it, 2 * i + 2 once that frame is complete. Readers
+// copy the payload optimistically and keep the copy only if the counter
+// named the frame they wanted and did not move around the copy.
+struct alignas(seqlock_cache_line_size) seqlock_slot {
+    std::atomic<uint64_t> sequence;
+    std::byte payload[seqlock_payload_size];
+};
+
+struct seqlock_statistics {
+    uint64_t retries; // copies torn by a concurrent update
+    uint64_t polls;   // reads that found no newer frame
+};
+
+// Single writer, any number of readers, and nobody ever waits for anybody:
+// frame i goes into slot i % slots and `published` then advertises it as the
+// latest. With one slot every read races the next update; with more, the
+// writer has to lap the ring before it touches the slot a reader is copying.
+struct seqlock_ring {
+    alignas(seqlock_cache_line_size) std::atomic<uint64_t> published; // index of the latest frame + 1
+    alignas(seqlock_cache_line_size) uint64_t mask;
+
+    static auto bytes_for(size_t slots) -> size_t {
+        return sizeof(seqlock_ring) + slots * sizeof(seqlock_slot);
+    }
+
+    // slots must be a power of two
+    static auto create(void *memory, size_t slots) -> seqlock_ring * {
+        seqlock_ring *ring = new (memory) seqlock_ring;
+        ring->published.store(0, std::memory_order_relaxed);
+        ring->mask = slots - 1;
+        for (size_t i = 0; i < slots; ++i)
+            new (&ring->slots()[i]) seqlock_slot{{0}, {}};
+        return ring;
+    }
+
+    auto slots() -> seqlock_slot * {
+        return reinterpret_cast<seqlock_slot *>(this + 1);
+    }
+
+    auto publish(uint64_t index, const std::byte *payload) -> void {
+        seqlock_slot &slot = slots()[index & mask];
+        slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(slot.payload, payload, seqlock_payload_size);
+        slot.sequence.store(2 * index + 2, std::memory_order_release);
+        published.store(index + 1, std::memory_order_release);
+    }
+
+    // Copies the latest frame if it is newer than `seen` (a frame count, as
+    // in `published`) and returns the new count; returns `seen` unchanged
+    // when nothing new was published. A slot being rewritten, or already
+    // lapped by the writer, counts as a retry. A reader that keeps retrying
+    // yields now and then, in case it is spinning on a preempted writer.
+    auto read_latest(uint64_t seen, std::byte *payload, seqlock_statistics &stats) -> uint64_t {
+        for (size_t attempt = 1;; ++attempt) {
+            uint64_t latest = published.load(std::memory_order_acquire);
+            if (latest == seen) {
+                ++stats.polls;
+                return seen;
+            }
+            seqlock_slot &slot = slots()[(latest - 1) & mask];
+            uint64_t before = slot.sequence.load(std::memory_order_acquire);
+            if (before == 2 * latest) {
+                std::memcpy(payload, slot.payload, seqlock_payload_size);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) == before)
+                    return latest;
+            }
+            ++stats.retries;
+            if (attempt % seqlock_yield_after == 0)
+                sched_yield();
+        }
+    }
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+#endif
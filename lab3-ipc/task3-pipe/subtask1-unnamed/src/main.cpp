@@ -1,15 +1,28 @@
 #include <algorithm>
 #include <chrono>
+#include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
+#include <format>
+#include <fstream>
 #include <iostream>
+#include <string_view>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <vector>
 
 constexpr size_t message_size = 1 << 20;
 constexpr size_t output_interval = 1e4;
 constexpr size_t send_round = 1e5;
 constexpr uint64_t generating_seed = 2022212720;
+constexpr size_t page_size = 1 << 12;
+constexpr size_t gift_buffers = 2;
+constexpr size_t sweep_round = 1e3;
+constexpr size_t default_pipe_size = 1 << 16;
+constexpr size_t sweep_chunk_sizes[] = {1 << 12, 1 << 14, 1 << 16, 1 << 18, 1 << 20};
 
 struct frame {
     std::byte data[message_size];
@@ -21,8 +34,39 @@ struct frame {
     }
 };
 
+enum class writer_mode {
+    write,
+    vmsplice,
+};
+
+enum class reader_mode {
+    read,
+    splice,
+    vmsplice,
+};
+
+struct cpu_time {
+    double user;
+    double sys;
+
+    static auto now() -> cpu_time {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return {usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6,
+                usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6};
+    }
+};
+
+static inline auto report_cpu_time(std::string_view side, const cpu_time &start) -> void {
+    cpu_time end = cpu_time::now();
+    std::cout
+        << std::format("{} CPU time: user {} s, sys {} s", side, end.user - start.user, end.sys - start.sys)
+        << std::endl;
+}
+
 static inline auto writer(int write_fd) -> void {
     frame *msg_frame = new frame;
+    cpu_time start_cpu = cpu_time::now();
     auto start_time = std::chrono::high_resolution_clock::now();
 
     for (size_t i = 0; i < send_round; ++i) {
@@ -57,11 +101,67 @@ static inline auto writer(int write_fd) -> void {
     double total_speed = send_round * message_size / (1024.0 * 1024.0) / total_elapsed.count();
 
     std::cout << std::format("Writer total speed: {} MiB/s", total_speed) << std::endl;
+    report_cpu_time("Writer", start_cpu);
+}
+
+// Gifted pages stay referenced by the pipe until the reader consumes them,
+// so the writer rotates through more frames than the pipe can hold.
+static inline auto gift_writer(int write_fd) -> void {
+    frame *msg_frames = static_cast<frame *>(std::aligned_alloc(page_size, gift_buffers * sizeof(frame)));
+    if (msg_frames == nullptr) {
+        perror("aligned_alloc");
+        exit(EXIT_FAILURE);
+    }
+    cpu_time start_cpu = cpu_time::now();
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    for (size_t i = 0; i < send_round; ++i) {
+        frame *msg_frame = msg_frames + i % gift_buffers;
+        msg_frame->generate(generating_seed + i);
+
+        std::byte *begin = msg_frame->data;
+        std::byte *end = begin + message_size;
+        std::byte *ptr = begin;
+
+        while (ptr != end) {
+            iovec iov{ptr, static_cast<size_t>(end - ptr)};
+            auto result = vmsplice(write_fd, &iov, 1, SPLICE_F_GIFT);
+            if (result == -1) {
+                perror("vmsplice");
+                exit(EXIT_FAILURE);
+            }
+            ptr += result;
+        }
+
+        if ((i + 1) % output_interval == 0) {
+            auto current_time = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> elapsed = current_time - start_time;
+            double speed = (i + 1) * message_size / (1024.0 * 1024.0) / elapsed.count();
+            std::cout
+                << std::format("Writer processed {} frames at speed: {} MiB/s", i + 1, speed)
+                << std::endl;
+        }
+    }
+    std::free(msg_frames);
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> total_elapsed = end_time - start_time;
+    double total_speed = send_round * message_size / (1024.0 * 1024.0) / total_elapsed.count();
+
+    std::cout << std::format("Writer total speed: {} MiB/s", total_speed) << std::endl;
+    report_cpu_time("Writer", start_cpu);
 }
 
-static inline auto reader(int read_fd) -> void {
+static inline auto reader(int read_fd, const reader_mode mode, int sink_fd) -> void {
     frame *local_frame = new frame;
     frame *expected_frame = new frame;
+    struct stat sink_stat;
+    if (mode == reader_mode::splice && fstat(sink_fd, &sink_stat) == -1) {
+        perror("fstat");
+        exit(EXIT_FAILURE);
+    }
+    const bool seekable_sink = mode == reader_mode::splice && S_ISREG(sink_stat.st_mode);
+    cpu_time start_cpu = cpu_time::now();
     auto start_time = std::chrono::high_resolution_clock::now();
 
     for (size_t i = 0; i < send_round; ++i) {
@@ -69,20 +169,35 @@ static inline auto reader(int read_fd) -> void {
         std::byte *begin = local_frame->data;
         std::byte *end = begin + message_size;
         std::byte *ptr = begin;
+        loff_t sink_offset = 0;
 
         while (ptr != end) {
-            auto result = read(read_fd, ptr, end - ptr);
+            ssize_t result;
+            if (mode == reader_mode::read)
+                result = read(read_fd, ptr, end - ptr);
+            else if (mode == reader_mode::vmsplice) {
+                iovec iov{ptr, static_cast<size_t>(end - ptr)};
+                result = vmsplice(read_fd, &iov, 1, 0);
+            } else
+                result = splice(read_fd, nullptr, sink_fd, seekable_sink ? &sink_offset : nullptr,
+                                end - ptr, SPLICE_F_MOVE);
             if (result == -1) {
-                perror("read");
+                perror(mode == reader_mode::read ? "read" : mode == reader_mode::vmsplice ? "vmsplice" : "splice");
                 exit(EXIT_FAILURE);
             }
             ptr += result;
         }
 
 #ifdef FRAME_CHECK
-        expected_frame->generate(generating_seed + i);
-        if (!(*local_frame == *expected_frame))
-            std::cerr << std::format("Data mismatch at round {}", i) << std::endl;
+        if (mode != reader_mode::splice || seekable_sink) {
+            if (mode == reader_mode::splice && pread(sink_fd, local_frame, sizeof(frame), 0) != sizeof(frame)) {
+                perror("pread");
+                exit(EXIT_FAILURE);
+            }
+            expected_frame->generate(generating_seed + i);
+            if (!(*local_frame == *expected_frame))
+                std::cerr << std::format("Data mismatch at round {}", i) << std::endl;
+        }
 #endif
 
         if ((i + 1) % output_interval == 0) {
@@ -102,26 +217,207 @@ static inline auto reader(int read_fd) -> void {
     double total_speed = send_round * message_size / (1024.0 * 1024.0) / total_elapsed.count();
 
     std::cout << std::format("Reader total speed: {} MiB/s", total_speed) << std::endl;
+    report_cpu_time("Reader", start_cpu);
 }
 
-int main() {
+static inline auto pipe_max_size() -> size_t {
+    std::ifstream file("/proc/sys/fs/pipe-max-size");
+    size_t size = default_pipe_size;
+    if (!(file >> size))
+        std::cerr << "Failed to read /proc/sys/fs/pipe-max-size, using the default pipe size" << std::endl;
+    return size;
+}
+
+static inline auto set_pipe_size(int fd, size_t size) -> size_t {
+    int result = fcntl(fd, F_SETPIPE_SZ, static_cast<int>(size));
+    if (result == -1) {
+        perror("fcntl F_SETPIPE_SZ");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+static inline auto sweep_writer(int write_fd, const size_t chunk_size) -> void {
+    frame *msg_frame = new frame;
+
+    for (size_t i = 0; i < sweep_round; ++i) {
+        msg_frame->generate(generating_seed + i);
+
+        std::byte *begin = msg_frame->data;
+        std::byte *end = begin + message_size;
+        std::byte *ptr = begin;
+
+        while (ptr != end) {
+            auto result = write(write_fd, ptr, std::min<size_t>(chunk_size, end - ptr));
+            if (result == -1) {
+                perror("write");
+                exit(EXIT_FAILURE);
+            }
+            ptr += result;
+        }
+    }
+    delete msg_frame;
+}
+
+static inline auto sweep_reader(int read_fd, const size_t chunk_size) -> double {
+    frame *local_frame = new frame;
+    frame *expected_frame = new frame;
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    for (size_t i = 0; i < sweep_round; ++i) {
+
+        std::byte *begin = local_frame->data;
+        std::byte *end = begin + message_size;
+        std::byte *ptr = begin;
+
+        while (ptr != end) {
+            auto result = read(read_fd, ptr, std::min<size_t>(chunk_size, end - ptr));
+            if (result == -1) {
+                perror("read");
+                exit(EXIT_FAILURE);
+            }
+            ptr += result;
+        }
+
+#ifdef FRAME_CHECK
+        expected_frame->generate(generating_seed + i);
+        if (!(*local_frame == *expected_frame))
+            std::cerr << std::format("Data mismatch at round {}", i) << std::endl;
+#endif
+    }
+    delete local_frame;
+    delete expected_frame;
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> total_elapsed = end_time - start_time;
+    return sweep_round * message_size / (1024.0 * 1024.0) / total_elapsed.count();
+}
+
+static inline auto measure(const size_t pipe_size, const size_t chunk_size) -> double {
     int pipe_fd[2];
     if (pipe(pipe_fd) == -1) {
         perror("pipe");
         exit(EXIT_FAILURE);
     }
+    set_pipe_size(pipe_fd[1], pipe_size);
+
+    auto pid = fork();
+    if (!pid) {
+        close(pipe_fd[0]);
+        sweep_writer(pipe_fd[1], chunk_size);
+        close(pipe_fd[1]);
+        exit(EXIT_SUCCESS);
+    }
+
+    close(pipe_fd[1]);
+    double speed = sweep_reader(pipe_fd[0], chunk_size);
+    close(pipe_fd[0]);
+    wait(nullptr);
+    return speed;
+}
+
+static inline auto sweep() -> void {
+    std::vector<size_t> pipe_sizes;
+    for (size_t size = default_pipe_size; size <= pipe_max_size(); size <<= 1)
+        pipe_sizes.push_back(size);
+
+    std::cout << "Throughput (MiB/s), rows = pipe size (B), columns = chunk size (B)" << std::endl;
+    std::cout << std::format("{:>10}", "pipe");
+    for (size_t chunk_size : sweep_chunk_sizes)
+        std::cout << std::format("{:>12}", chunk_size);
+    std::cout << std::endl;
+
+    double best_speed = 0;
+    size_t best_pipe_size = 0, best_chunk_size = 0;
+    for (size_t pipe_size : pipe_sizes) {
+        std::cout << std::format("{:>10}", pipe_size) << std::flush;
+        for (size_t chunk_size : sweep_chunk_sizes) {
+            double speed = measure(pipe_size, chunk_size);
+            std::cout << std::format("{:>12.1f}", speed) << std::flush;
+            if (speed > best_speed) {
+                best_speed = speed;
+                best_pipe_size = pipe_size;
+                best_chunk_size = chunk_size;
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout
+        << std::format("Best: pipe size {} B, chunk size {} B, {:.1f} MiB/s", best_pipe_size, best_chunk_size, best_speed)
+        << std::endl;
+}
+
+static inline auto run(const writer_mode wmode, const reader_mode rmode, const char *sink_path) -> void {
+    int pipe_fd[2];
+    if (pipe(pipe_fd) == -1) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+
+    int sink_fd = -1;
+    if (rmode == reader_mode::splice) {
+        sink_fd = open(sink_path, O_RDWR | O_CREAT, 0600);
+        if (sink_fd == -1) {
+            perror("open sink");
+            exit(EXIT_FAILURE);
+        }
+    }
 
     auto pid = fork();
     if (pid) {
         close(pipe_fd[1]);
-        reader(pipe_fd[0]);
+        reader(pipe_fd[0], rmode, sink_fd);
         close(pipe_fd[0]);
         wait(nullptr);
     } else {
         close(pipe_fd[0]);
-        writer(pipe_fd[1]);
+        if (wmode == writer_mode::write)
+            writer(pipe_fd[1]);
+        else
+            gift_writer(pipe_fd[1]);
         close(pipe_fd[1]);
+        exit(EXIT_SUCCESS);
     }
 
+    if (sink_fd != -1)
+        close(sink_fd);
+}
+
+int main(int argc, char *argv[]) {
+    std::string_view wmode = argc > 1 ? argv[1] : "write";
+    std::string_view rmode = argc > 2 ? argv[2] : "read";
+    const char *sink_path = argc > 3 ? argv[3] : "/dev/null";
+
+    if (wmode == "sweep") {
+        sweep();
+        return 0;
+    }
+
+    if (wmode == "compare") {
+        sink_path = argc > 2 ? argv[2] : "/dev/null";
+        std::cout << "write + read" << std::endl;
+        run(writer_mode::write, reader_mode::read, sink_path);
+        std::cout << "vmsplice(SPLICE_F_GIFT) + read" << std::endl;
+        run(writer_mode::vmsplice, reader_mode::read, sink_path);
+        std::cout << "vmsplice(SPLICE_F_GIFT) + vmsplice" << std::endl;
+        run(writer_mode::vmsplice, reader_mode::vmsplice, sink_path);
+        std::cout << std::format("vmsplice(SPLICE_F_GIFT) + splice to {}", sink_path) << std::endl;
+        run(writer_mode::vmsplice, reader_mode::splice, sink_path);
+        return 0;
+    }
+
+    if ((wmode != "write" && wmode != "vmsplice") ||
+        (rmode != "read" && rmode != "splice" && rmode != "vmsplice")) {
+        std::cerr
+            << std::format("Usage: {0} [write|vmsplice] [read|splice|vmsplice] [sink] | {0} compare [sink] | {0} sweep", argv[0])
+            << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    run(wmode == "write" ? writer_mode::write : writer_mode::vmsplice,
+        rmode == "read" ? reader_mode::read : rmode == "splice" ? reader_mode::splice : reader_mode::vmsplice,
+        sink_path);
+
     return 0;
 }
@@ -1,16 +1,32 @@
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
 #include <chrono>
 #include <cstring>
 #include <fcntl.h>
+#include <format>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <sys/epoll.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <thread>
 #include <unistd.h>
+#include <vector>
 
 constexpr size_t message_size = 1 << 20;
 constexpr size_t output_interval = 1e4;
 constexpr size_t send_round = 1e5;
 constexpr uint64_t generating_seed = 2022212720;
+constexpr size_t sweep_round = 1e3;
+constexpr size_t default_pipe_size = 1 << 16;
+constexpr size_t sweep_chunk_sizes[] = {1 << 12, 1 << 14, 1 << 16, 1 << 18, 1 << 20};
+constexpr size_t striped_round = 1e3;
+constexpr size_t stripe_slot_count = 4;
+constexpr size_t striped_fifo_counts[] = {1, 2, 4, 8};
+constexpr size_t striped_thread_counts[] = {1, 2, 4};
 
 struct frame {
     std::byte data[message_size];
@@ -94,14 +110,479 @@ static inline auto reader(int read_fd) -> void {
     std::cout << std::format("Reader total speed: {} MiB/s", total_speed) << std::endl;
 }
 
-int main() {
+static inline auto pipe_max_size() -> size_t {
+    std::ifstream file("/proc/sys/fs/pipe-max-size");
+    size_t size = default_pipe_size;
+    if (!(file >> size))
+        std::cerr << "Failed to read /proc/sys/fs/pipe-max-size, using the default pipe size" << std::endl;
+    return size;
+}
+
+static inline auto set_pipe_size(int fd, size_t size) -> size_t {
+    int result = fcntl(fd, F_SETPIPE_SZ, static_cast<int>(size));
+    if (result == -1) {
+        perror("fcntl F_SETPIPE_SZ");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+static inline auto sweep_writer(int write_fd, const size_t chunk_size) -> void {
+    frame *msg_frame = new frame;
+
+    for (size_t i = 0; i < sweep_round; ++i) {
+        msg_frame->generate(generating_seed + i);
+
+        auto ptr = reinterpret_cast<char *>(msg_frame);
+        auto end = ptr + sizeof(frame);
+        while (ptr != end) {
+            auto result = write(write_fd, ptr, std::min<size_t>(chunk_size, end - ptr));
+            if (result == -1) {
+                perror("write");
+                exit(EXIT_FAILURE);
+            }
+            ptr += result;
+        }
+    }
+    delete msg_frame;
+}
+
+static inline auto sweep_reader(int read_fd, const size_t chunk_size) -> void {
+    frame *local_frame = new frame;
+    frame *expected_frame = new frame;
+
+    for (size_t i = 0; i < sweep_round; ++i) {
+        auto ptr = reinterpret_cast<char *>(local_frame);
+        auto end = ptr + sizeof(frame);
+        while (ptr != end) {
+            auto result = read(read_fd, ptr, std::min<size_t>(chunk_size, end - ptr));
+            if (result == -1) {
+                perror("read");
+                exit(EXIT_FAILURE);
+            }
+            ptr += result;
+        }
+
+#ifdef FRAME_CHECK
+        expected_frame->generate(generating_seed + i);
+        if (!(*local_frame == *expected_frame))
+            std::cerr << std::format("Data mismatch at round {}", i) << std::endl;
+#endif
+    }
+    delete local_frame;
+    delete expected_frame;
+}
+
+// The writer is timed until the reader has drained the FIFO, so the
+// speed covers the whole transfer and not only filling the pipe buffer.
+static inline auto measure(const char *fifo_path, const size_t pipe_size, const size_t chunk_size) -> double {
+    auto pid = fork();
+    if (pid == 0) {
+        int read_fd = open(fifo_path, O_RDONLY);
+        if (read_fd == -1) {
+            perror("open fifo for reading");
+            exit(EXIT_FAILURE);
+        }
+
+        sweep_reader(read_fd, chunk_size);
+        close(read_fd);
+        exit(EXIT_SUCCESS);
+    }
+
+    int write_fd = open(fifo_path, O_WRONLY);
+    if (write_fd == -1) {
+        perror("open fifo for writing");
+        exit(EXIT_FAILURE);
+    }
+    set_pipe_size(write_fd, pipe_size);
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    sweep_writer(write_fd, chunk_size);
+    close(write_fd);
+    wait(nullptr);
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> total_elapsed = end_time - start_time;
+    return sweep_round * message_size / (1024.0 * 1024.0) / total_elapsed.count();
+}
+
+static inline auto sweep(const char *fifo_path) -> void {
+    std::vector<size_t> pipe_sizes;
+    for (size_t size = default_pipe_size; size <= pipe_max_size(); size <<= 1)
+        pipe_sizes.push_back(size);
+
+    std::cout << "Throughput (MiB/s), rows = pipe size (B), columns = chunk size (B)" << std::endl;
+    std::cout << std::format("{:>10}", "pipe");
+    for (size_t chunk_size : sweep_chunk_sizes)
+        std::cout << std::format("{:>12}", chunk_size);
+    std::cout << std::endl;
+
+    double best_speed = 0;
+    size_t best_pipe_size = 0, best_chunk_size = 0;
+    for (size_t pipe_size : pipe_sizes) {
+        std::cout << std::format("{:>10}", pipe_size) << std::flush;
+        for (size_t chunk_size : sweep_chunk_sizes) {
+            double speed = measure(fifo_path, pipe_size, chunk_size);
+            std::cout << std::format("{:>12.1f}", speed) << std::flush;
+            if (speed > best_speed) {
+                best_speed = speed;
+                best_pipe_size = pipe_size;
+                best_chunk_size = chunk_size;
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout
+        << std::format("Best: pipe size {} B, chunk size {} B, {:.1f} MiB/s", best_pipe_size, best_chunk_size, best_speed)
+        << std::endl;
+}
+
+// Striped mode: every frame is cut into K stripes that travel through K
+// FIFOs at once, each stripe behind a header naming its frame and place.
+// The reader spreads the FIFOs over its threads; each thread waits on its
+// read ends with epoll and copies stripes straight into a small ring of
+// frame slots, and whichever thread delivers the last stripe of a frame
+// checks it and frees the slot.
+struct stripe_header {
+    uint64_t sequence;
+    uint32_t stripe;
+    uint32_t length;
+};
+
+struct stripe_slot {
+    frame data;
+    std::atomic<uint64_t> sequence; // frame this slot is waiting for
+    std::atomic<size_t> remaining;  // stripes still to arrive
+};
+
+struct stripe_stream {
+    int fd;
+    uint32_t stripe;
+    stripe_header header;
+    size_t header_done = 0;
+    size_t payload_done = 0;
+    bool stalled = false;
+};
+
+static inline auto stripe_fifo_path(size_t stripe) -> std::string {
+    return std::format("/tmp/my_fifo_stripe_{}", stripe);
+}
+
+static inline auto stripe_offset(size_t stripe, size_t stripes) -> size_t {
+    return message_size / stripes * stripe;
+}
+
+static inline auto stripe_length(size_t stripe, size_t stripes) -> size_t {
+    return stripe + 1 == stripes ? message_size - stripe_offset(stripe, stripes) : message_size / stripes;
+}
+
+static inline auto set_nonblocking(int fd) -> void {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        perror("fcntl O_NONBLOCK");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static inline auto epoll_watch(int epoll_fd, int op, stripe_stream &stream, uint32_t events) -> void {
+    epoll_event event{};
+    event.events = events;
+    event.data.ptr = &stream;
+    if (epoll_ctl(epoll_fd, op, stream.fd, &event) == -1) {
+        perror("epoll_ctl");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Writes every stripe of one frame, switching to whichever FIFO has room.
+// A FIFO leaves the wait set once its stripe is written, or level-triggered
+// EPOLLOUT would report it ready for the rest of the frame and spin the
+// writer, and every FIFO is armed again when the next frame starts.
+static inline auto striped_writer(const std::vector<int> &write_fds) -> void {
+    const size_t stripes = write_fds.size();
+    frame *msg_frame = new frame;
+    std::vector<stripe_stream> streams(stripes);
+    int epoll_fd = epoll_create1(0);
+    if (epoll_fd == -1) {
+        perror("epoll_create1");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t k = 0; k < stripes; ++k) {
+        streams[k].fd = write_fds[k];
+        streams[k].stripe = k;
+        epoll_watch(epoll_fd, EPOLL_CTL_ADD, streams[k], 0);
+    }
+
+    std::vector<epoll_event> events(stripes);
+    for (size_t i = 0; i < striped_round; ++i) {
+        msg_frame->generate(generating_seed + i);
+        size_t unfinished = stripes;
+        for (auto &stream : streams) {
+            stream.header = {i, stream.stripe, static_cast<uint32_t>(stripe_length(stream.stripe, stripes))};
+            stream.header_done = stream.payload_done = 0;
+            epoll_watch(epoll_fd, EPOLL_CTL_MOD, stream, EPOLLOUT);
+        }
+
+        while (unfinished) {
+            int ready = epoll_wait(epoll_fd, events.data(), stripes, -1);
+            if (ready == -1) {
+                perror("epoll_wait");
+                exit(EXIT_FAILURE);
+            }
+            for (int e = 0; e < ready; ++e) {
+                auto &stream = *static_cast<stripe_stream *>(events[e].data.ptr);
+                const size_t length = stream.header.length;
+                while (stream.payload_done != length) {
+                    const std::byte *ptr;
+                    size_t left;
+                    if (stream.header_done != sizeof(stripe_header)) {
+                        ptr = reinterpret_cast<const std::byte *>(&stream.header) + stream.header_done;
+                        left = sizeof(stripe_header) - stream.header_done;
+                    } else {
+                        ptr = msg_frame->data + stripe_offset(stream.stripe, stripes) + stream.payload_done;
+                        left = length - stream.payload_done;
+                    }
+                    auto result = write(stream.fd, ptr, left);
+                    if (result == -1 && errno == EAGAIN)
+                        break;
+                    if (result == -1) {
+                        perror("write");
+                        exit(EXIT_FAILURE);
+                    }
+                    if (stream.header_done != sizeof(stripe_header))
+                        stream.header_done += result;
+                    else
+                        stream.payload_done += result;
+                }
+                if (stream.payload_done == length) {
+                    epoll_watch(epoll_fd, EPOLL_CTL_MOD, stream, 0);
+                    --unfinished;
+                }
+            }
+        }
+    }
+    close(epoll_fd);
+    delete msg_frame;
+}
+
+// Reads what is available from one FIFO; returns once it would block,
+// after a stripe whose frame slot is still busy, or at end of stream.
+static inline auto drain_stripe_stream(stripe_stream &stream, std::vector<stripe_slot> &slots, size_t stripes,
+                                       std::atomic<size_t> &frames_done, [[maybe_unused]] frame *expected_frame) -> void {
+    while (true) {
+        if (stream.header_done != sizeof(stripe_header)) {
+            auto result = read(stream.fd, reinterpret_cast<std::byte *>(&stream.header) + stream.header_done,
+                               sizeof(stripe_header) - stream.header_done);
+            if (result == -1 && errno == EAGAIN)
+                return;
+            if (result == -1) {
+                perror("read");
+                exit(EXIT_FAILURE);
+            }
+            if (result == 0)
+                return;
+            stream.header_done += result;
+            if (stream.header_done != sizeof(stripe_header))
+                continue;
+            if (stream.header.stripe != stream.stripe || stream.header.length != stripe_length(stream.stripe, stripes)) {
+                std::cerr << std::format("Bad stripe header on FIFO {}", stream.stripe) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        stripe_slot &slot = slots[stream.header.sequence % slots.size()];
+        stream.stalled = slot.sequence.load(std::memory_order_acquire) != stream.header.sequence;
+        if (stream.stalled)
+            return;
+
+        std::byte *base = slot.data.data + stripe_offset(stream.stripe, stripes);
+        while (stream.payload_done != stream.header.length) {
+            auto result = read(stream.fd, base + stream.payload_done, stream.header.length - stream.payload_done);
+            if (result == -1 && errno == EAGAIN)
+                return;
+            if (result == -1) {
+                perror("read");
+                exit(EXIT_FAILURE);
+            }
+            if (result == 0)
+                return;
+            stream.payload_done += result;
+        }
+
+        if (slot.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+#ifdef FRAME_CHECK
+            expected_frame->generate(generating_seed + stream.header.sequence);
+            if (!(slot.data == *expected_frame))
+                std::cerr << std::format("Data mismatch at round {}", stream.header.sequence) << std::endl;
+#endif
+            slot.remaining.store(stripes, std::memory_order_relaxed);
+            slot.sequence.store(stream.header.sequence + slots.size(), std::memory_order_release);
+            frames_done.fetch_add(1, std::memory_order_relaxed);
+        }
+        stream.header_done = stream.payload_done = 0;
+    }
+}
+
+// A stalled FIFO is taken out of the epoll set, or level triggering would
+// spin on it, and retried every millisecond until its slot is free.
+static inline auto striped_reader_thread(std::vector<stripe_stream *> streams, std::vector<stripe_slot> &slots,
+                                         size_t stripes, std::atomic<size_t> &frames_done) -> void {
+    frame *expected_frame = new frame;
+    int epoll_fd = epoll_create1(0);
+    if (epoll_fd == -1) {
+        perror("epoll_create1");
+        exit(EXIT_FAILURE);
+    }
+    for (auto *stream : streams)
+        epoll_watch(epoll_fd, EPOLL_CTL_ADD, *stream, EPOLLIN);
+
+    std::vector<epoll_event> events(streams.size());
+    while (frames_done.load(std::memory_order_relaxed) != striped_round) {
+        bool any_stalled = false;
+        for (auto *stream : streams)
+            if (stream->stalled) {
+                drain_stripe_stream(*stream, slots, stripes, frames_done, expected_frame);
+                if (!stream->stalled)
+                    epoll_watch(epoll_fd, EPOLL_CTL_MOD, *stream, EPOLLIN);
+                any_stalled |= stream->stalled;
+            }
+
+        int ready = epoll_wait(epoll_fd, events.data(), events.size(), any_stalled ? 1 : 10);
+        if (ready == -1) {
+            perror("epoll_wait");
+            exit(EXIT_FAILURE);
+        }
+        for (int e = 0; e < ready; ++e) {
+            auto &stream = *static_cast<stripe_stream *>(events[e].data.ptr);
+            drain_stripe_stream(stream, slots, stripes, frames_done, expected_frame);
+            if (stream.stalled)
+                epoll_watch(epoll_fd, EPOLL_CTL_MOD, stream, 0);
+        }
+    }
+    close(epoll_fd);
+    delete expected_frame;
+}
+
+static inline auto striped_reader(const std::vector<int> &read_fds, size_t threads) -> void {
+    const size_t stripes = read_fds.size();
+    std::vector<stripe_slot> slots(stripe_slot_count);
+    for (size_t i = 0; i < slots.size(); ++i) {
+        slots[i].sequence.store(i);
+        slots[i].remaining.store(stripes);
+    }
+
+    std::vector<stripe_stream> streams(stripes);
+    std::vector<std::vector<stripe_stream *>> assigned(threads);
+    for (size_t k = 0; k < stripes; ++k) {
+        streams[k].fd = read_fds[k];
+        streams[k].stripe = k;
+        assigned[k % threads].push_back(&streams[k]);
+    }
+
+    std::atomic<size_t> frames_done = 0;
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t)
+        workers.emplace_back(striped_reader_thread, assigned[t], std::ref(slots), stripes, std::ref(frames_done));
+    for (auto &worker : workers)
+        worker.join();
+}
+
+static inline auto measure_striped(size_t stripes, size_t threads) -> double {
+    for (size_t k = 0; k < stripes; ++k)
+        if (mkfifo(stripe_fifo_path(k).c_str(), 0600) == -1 && errno != EEXIST) {
+            perror("mkfifo");
+            exit(EXIT_FAILURE);
+        }
+
+    std::cout << std::flush;
+    auto pid = fork();
+    if (pid == 0) {
+        std::vector<int> read_fds;
+        for (size_t k = 0; k < stripes; ++k) {
+            int read_fd = open(stripe_fifo_path(k).c_str(), O_RDONLY | O_NONBLOCK);
+            if (read_fd == -1) {
+                perror("open fifo for reading");
+                exit(EXIT_FAILURE);
+            }
+            read_fds.push_back(read_fd);
+        }
+        striped_reader(read_fds, threads);
+        for (int read_fd : read_fds)
+            close(read_fd);
+        exit(EXIT_SUCCESS);
+    }
+
+    std::vector<int> write_fds;
+    for (size_t k = 0; k < stripes; ++k) {
+        int write_fd = open(stripe_fifo_path(k).c_str(), O_WRONLY);
+        if (write_fd == -1) {
+            perror("open fifo for writing");
+            exit(EXIT_FAILURE);
+        }
+        set_nonblocking(write_fd);
+        write_fds.push_back(write_fd);
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    striped_writer(write_fds);
+    for (int write_fd : write_fds)
+        close(write_fd);
+    wait(nullptr);
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    for (size_t k = 0; k < stripes; ++k)
+        unlink(stripe_fifo_path(k).c_str());
+
+    std::chrono::duration<double> total_elapsed = end_time - start_time;
+    return striped_round * message_size / (1024.0 * 1024.0) / total_elapsed.count();
+}
+
+static inline auto striped() -> void {
+    std::cout << "Throughput (MiB/s), rows = FIFOs (K), columns = reader threads" << std::endl;
+    std::cout << std::format("{:>10}", "K");
+    for (size_t threads : striped_thread_counts)
+        std::cout << std::format("{:>12}", threads);
+    std::cout << std::endl;
+
+    for (size_t stripes : striped_fifo_counts) {
+        std::cout << std::format("{:>10}", stripes) << std::flush;
+        for (size_t threads : striped_thread_counts) {
+            if (threads > stripes)
+                std::cout << std::format("{:>12}", "-");
+            else
+                std::cout << std::format("{:>12.1f}", measure_striped(stripes, threads));
+            std::cout << std::flush;
+        }
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
     const char *fifo_path = "/tmp/my_fifo";
+    std::string_view mode = argc > 1 ? argv[1] : "stream";
+
+    if (mode != "stream" && mode != "sweep" && mode != "striped") {
+        std::cerr << std::format("Usage: {} [stream|sweep|striped]", argv[0]) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (mode == "striped") {
+        striped();
+        return 0;
+    }
 
     if (mkfifo(fifo_path, 0600) == -1 && errno != EEXIST) {
         perror("mkfifo");
         exit(EXIT_FAILURE);
     }
 
+    if (mode == "sweep") {
+        sweep(fifo_path);
+        unlink(fifo_path);
+        return 0;
+    }
+
     auto pid = fork();
     if (pid == 0) {
         int read_fd = open(fifo_path, O_RDONLY);
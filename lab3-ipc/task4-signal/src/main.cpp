@@ -1,11 +1,27 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <csignal>
+#include <cstdio>
+#include <cstdlib>
 #include <format>
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <vector>
 
 constexpr int signals[] = {16, 17};
+constexpr size_t control_rounds = 100;
+constexpr size_t control_child_counts[] = {1, 16, 256, 1024, 4096};
+constexpr size_t control_max_children = 16384;
+constexpr int control_stop = -1;       // command payload that ends a child
+constexpr time_t control_timeout = 10; // seconds a round may take
+constexpr size_t control_batch = 64;   // siginfos taken per read()
 std::vector<int> pids;
 
 static inline auto handler(int signal) -> void {
@@ -45,7 +61,247 @@ static inline auto wait_for_signal(void) -> void {
 static inline auto empty_handler([[maybe_unused]] int _) -> void {
 }
 
-int main() {
+// The control plane runs on two real-time signals, which queue one
+// instance per sigqueue() and carry an int payload, unlike SIGUSR1/2 that
+// collapse into a single pending bit. Both stay blocked in every process
+// and are only ever read through a signalfd, so no handler runs at all.
+static inline auto command_signal() -> int { return SIGRTMIN; }
+static inline auto reply_signal() -> int { return SIGRTMIN + 1; }
+
+static inline auto control_signals() -> sigset_t {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, command_signal());
+    sigaddset(&set, reply_signal());
+    return set;
+}
+
+// Queued real-time signals count against RLIMIT_SIGPENDING for the whole
+// user. Returns false when that is exhausted so the caller can drain first.
+static inline auto try_queue_signal(pid_t pid, int sig, int payload) -> bool {
+    sigval value{};
+    value.sival_int = payload;
+    if (sigqueue(pid, sig, value) == 0)
+        return true;
+    if (errno != EAGAIN) {
+        perror("sigqueue");
+        exit(EXIT_FAILURE);
+    }
+    return false;
+}
+
+static inline auto queue_signal(pid_t pid, int sig, int payload) -> void {
+    while (!try_queue_signal(pid, sig, payload))
+        sched_yield();
+}
+
+// Echoes every command back to the parent with the same payload.
+static inline auto control_child(pid_t parent) -> void {
+    sigset_t commands;
+    sigemptyset(&commands);
+    sigaddset(&commands, command_signal());
+    int signal_fd = signalfd(-1, &commands, SFD_CLOEXEC);
+    if (signal_fd == -1) {
+        perror("signalfd");
+        exit(EXIT_FAILURE);
+    }
+
+    signalfd_siginfo infos[control_batch];
+    while (true) {
+        ssize_t bytes = read(signal_fd, infos, sizeof(infos));
+        if (bytes == -1) {
+            if (errno == EINTR)
+                continue;
+            perror("read signalfd");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < bytes / sizeof(signalfd_siginfo); ++i) {
+            if (infos[i].ssi_int == control_stop)
+                exit(EXIT_SUCCESS);
+            queue_signal(parent, reply_signal(), infos[i].ssi_int);
+        }
+    }
+}
+
+static inline auto kill_children(const std::vector<pid_t> &children) -> void {
+    for (pid_t child : children)
+        kill(child, SIGKILL);
+    for (size_t i = 0; i < children.size(); ++i)
+        wait(nullptr);
+}
+
+struct control_round {
+    uint64_t fan_out_ns;     // until the last command was queued
+    uint64_t first_reply_ns; // until the first reply was read
+    uint64_t fan_in_ns;      // until the last reply was read
+};
+
+// The parent's event loop: one epoll set with the reply signalfd and a
+// timerfd that bounds each round, so a lost child ends the run instead of
+// hanging it.
+struct control_plane {
+    std::vector<pid_t> children;
+    int signal_fd;
+    int timer_fd;
+    int epoll_fd;
+
+    explicit control_plane(std::vector<pid_t> children) : children(std::move(children)) {
+        sigset_t replies;
+        sigemptyset(&replies);
+        sigaddset(&replies, reply_signal());
+        signal_fd = signalfd(-1, &replies, SFD_NONBLOCK | SFD_CLOEXEC);
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (signal_fd == -1 || timer_fd == -1 || epoll_fd == -1) {
+            perror("control plane descriptors");
+            exit(EXIT_FAILURE);
+        }
+        for (int fd : {signal_fd, timer_fd}) {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+                perror("epoll_ctl");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    ~control_plane() {
+        close(epoll_fd);
+        close(timer_fd);
+        close(signal_fd);
+    }
+
+    // Reads every reply queued so far; returns how many carried `round`.
+    auto drain(int round, size_t &stray) -> size_t {
+        signalfd_siginfo infos[control_batch];
+        size_t replies = 0;
+        while (true) {
+            ssize_t bytes = read(signal_fd, infos, sizeof(infos));
+            if (bytes == -1) {
+                if (errno == EAGAIN)
+                    return replies;
+                if (errno == EINTR)
+                    continue;
+                perror("read signalfd");
+                exit(EXIT_FAILURE);
+            }
+            for (size_t i = 0; i < bytes / sizeof(signalfd_siginfo); ++i) {
+                if (infos[i].ssi_int == round)
+                    ++replies;
+                else
+                    ++stray;
+            }
+        }
+    }
+
+    // Sends `round` to every child and waits for all the echoes. Commands
+    // that hit the pending-signal limit are retried after draining replies.
+    auto run(int round, size_t &stray) -> control_round {
+        itimerspec deadline{};
+        deadline.it_value.tv_sec = control_timeout;
+        timerfd_settime(timer_fd, 0, &deadline, nullptr);
+
+        auto since = [start = std::chrono::steady_clock::now()] {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        };
+        control_round result{};
+        size_t sent = 0, received = 0;
+
+        while (received < children.size()) {
+            while (sent < children.size() && try_queue_signal(children[sent], command_signal(), round))
+                ++sent;
+            if (sent == children.size() && result.fan_out_ns == 0)
+                result.fan_out_ns = since();
+
+            epoll_event events[2];
+            int ready = epoll_wait(epoll_fd, events, 2, sent < children.size() ? 0 : -1);
+            if (ready == -1 && errno != EINTR) {
+                perror("epoll_wait");
+                exit(EXIT_FAILURE);
+            }
+            for (int i = 0; i < ready; ++i) {
+                if (events[i].data.fd == timer_fd) {
+                    std::cerr
+                        << std::format("Round {} timed out with {} of {} replies", round, received, children.size())
+                        << std::endl;
+                    kill_children(children);
+                    exit(EXIT_FAILURE);
+                }
+                size_t replies = drain(round, stray);
+                if (replies > 0 && received == 0)
+                    result.first_reply_ns = since();
+                received += replies;
+            }
+        }
+        result.fan_in_ns = since();
+        return result;
+    }
+};
+
+static inline auto run_control(const size_t child_count) -> void {
+    sigset_t blocked = control_signals();
+    if (sigprocmask(SIG_BLOCK, &blocked, nullptr) == -1) {
+        perror("sigprocmask");
+        exit(EXIT_FAILURE);
+    }
+
+    pid_t parent = getpid();
+    std::vector<pid_t> children;
+    std::cout << std::flush;
+    for (size_t i = 0; i < child_count; ++i) {
+        auto pid = fork();
+        if (pid == -1) {
+            perror("fork");
+            kill_children(children);
+            exit(EXIT_FAILURE);
+        }
+        if (pid == 0)
+            control_child(parent);
+        children.push_back(pid);
+    }
+
+    control_plane plane(children);
+    size_t stray = 0;
+    plane.run(0, stray); // every child has its signalfd open after this
+
+    std::vector<control_round> rounds;
+    auto start_time = std::chrono::steady_clock::now();
+    for (size_t round = 1; round <= control_rounds; ++round)
+        rounds.push_back(plane.run(round, stray));
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+
+    for (pid_t child : children)
+        queue_signal(child, command_signal(), control_stop);
+    for (size_t i = 0; i < child_count; ++i)
+        wait(nullptr);
+
+    uint64_t fan_out = 0, first_reply = 0;
+    std::vector<uint64_t> fan_in;
+    for (const auto &round : rounds) {
+        fan_out += round.fan_out_ns;
+        first_reply += round.first_reply_ns;
+        fan_in.push_back(round.fan_in_ns);
+    }
+    uint64_t fan_in_total = 0;
+    for (uint64_t ns : fan_in)
+        fan_in_total += ns;
+    std::sort(fan_in.begin(), fan_in.end());
+    if (stray > 0)
+        std::cerr << std::format("{} replies carried a stale round number", stray) << std::endl;
+
+    std::cout
+        << std::format("Children = {}: {} signals/s, fan-out {} us, first reply {} us, "
+                       "all replies mean {} us, p50 {} us, p99 {} us, max {} us",
+                       child_count, 2.0 * child_count * control_rounds / elapsed.count(),
+                       fan_out / control_rounds / 1e3, first_reply / control_rounds / 1e3,
+                       fan_in_total / control_rounds / 1e3, fan_in[control_rounds / 2] / 1e3,
+                       fan_in[control_rounds * 99 / 100] / 1e3, fan_in.back() / 1e3)
+        << std::endl;
+}
+
+static inline auto classic() -> void {
     signal(SIGTSTP, global_handler);
 
     for (int sig : signals) {
@@ -60,5 +316,27 @@ int main() {
     }
 
     wait_for_signal();
+}
+
+int main(int argc, char *argv[]) {
+    std::string_view mode = argc > 1 ? argv[1] : "";
+
+    if (mode.empty())
+        classic();
+    else if (mode == "control" && argc > 2) {
+        size_t children = std::stoul(argv[2]);
+        if (children == 0 || children > control_max_children) {
+            std::cerr << std::format("Child count must be between 1 and {}", control_max_children) << std::endl;
+            return EXIT_FAILURE;
+        }
+        run_control(children);
+    } else if (mode == "control") {
+        for (size_t children : control_child_counts)
+            run_control(children);
+    } else {
+        std::cerr << std::format("Usage: {} [control [children]]", argv[0]) << std::endl;
+        return EXIT_FAILURE;
+    }
+
     return 0;
 }
@@ -0,0 +1,120 @@
+#pragma once
+
+#ifndef COPY_H
+#define COPY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <immintrin.h>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+enum class copy_engine {
+    libc,      // plain memcpy
+    streaming, // non-temporal stores with software prefetch above a threshold
+};
+
+static inline auto copy_engine_name(copy_engine engine) -> std::string_view {
+    return engine == copy_engine::streaming ? "nt" : "memcpy";
+}
+
+struct copy_policy {
+    copy_engine engine = copy_engine::libc;
+    size_t threshold = 0; // smaller copies always use memcpy
+};
+
+static inline auto copy_settings(const copy_policy &policy) -> std::string {
+    if (policy.engine == copy_engine::libc)
+        return "copy=memcpy";
+    return std::format("copy=nt>={}", policy.threshold);
+}
+
+// Half of L2: a copy bigger than this would push out most of what the
+// reader had cached before the frame arrived.
+static inline auto default_copy_threshold() -> size_t {
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    return l2 > 0 ? l2 / 2 : 256 << 10;
+}
+
+// Prefetched with NTA ahead of the loads, so the source lines go no further
+// than the closest cache level instead of displacing L2.
+constexpr size_t copy_prefetch_distance = 1024;
+
+__attribute__((target("avx512f"))) static inline auto stream_blocks_avx512(std::byte *dst, const std::byte *src, size_t blocks) -> void {
+    for (size_t i = 0; i < blocks; ++i, dst += 256, src += 256) {
+        _mm_prefetch(reinterpret_cast<const char *>(src + copy_prefetch_distance), _MM_HINT_NTA);
+        _mm_prefetch(reinterpret_cast<const char *>(src + copy_prefetch_distance + 64), _MM_HINT_NTA);
+        _mm_prefetch(reinterpret_cast<const char *>(src + copy_prefetch_distance + 128), _MM_HINT_NTA);
+        _mm_prefetch(reinterpret_cast<const char *>(src + copy_prefetch_distance + 192), _MM_HINT_NTA);
+        __m512i a = _mm512_loadu_si512(src);
+        __m512i b = _mm512_loadu_si512(src + 64);
+        __m512i c = _mm512_loadu_si512(src + 128);
+        __m512i d = _mm512_loadu_si512(src + 192);
+        _mm512_stream_si512(reinterpret_cast<__m512i *>(dst), a);
+        _mm512_stream_si512(reinterpret_cast<__m512i *>(dst + 64), b);
+        _mm512_stream_si512(reinterpret_cast<__m512i *>(dst + 128), c);
+        _mm512_stream_si512(reinterpret_cast<__m512i *>(dst + 192), d);
+    }
+}
+
+__attribute__((target("avx2"))) static inline auto stream_blocks_avx2(std::byte *dst, const std::byte *src, size_t blocks) -> void {
+    for (size_t i = 0; i < blocks; ++i, dst += 256, src += 256) {
+        for (size_t line = 0; line < 256; line += 64) {
+            _mm_prefetch(reinterpret_cast<const char *>(src + copy_prefetch_distance + line), _MM_HINT_NTA);
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + line));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + line + 32));
+            _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + line), a);
+            _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + line + 32), b);
+        }
+    }
+}
+
+static inline auto stream_blocks_sse2(std::byte *dst, const std::byte *src, size_t blocks) -> void {
+    for (size_t i = 0; i < blocks; ++i, dst += 256, src += 256) {
+        for (size_t line = 0; line < 256; line += 64) {
+            _mm_prefetch(reinterpret_cast<const char *>(src + copy_prefetch_distance + line), _MM_HINT_NTA);
+            for (size_t part = 0; part < 64; part += 16) {
+                __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + line + part));
+                _mm_stream_si128(reinterpret_cast<__m128i *>(dst + line + part), value);
+            }
+        }
+    }
+}
+
+// Copies 256-byte blocks with non-temporal stores once the destination is
+// cache-line aligned; the unaligned head and the tail go through memcpy.
+// The stores bypass the cache, so the copy does not evict the reader's
+// working set, at the price of the destination not being cached afterwards.
+static inline auto streaming_copy(std::byte *dst, const std::byte *src, size_t size) -> void {
+    static const auto stream_blocks = [] {
+        if (__builtin_cpu_supports("avx512f"))
+            return stream_blocks_avx512;
+        if (__builtin_cpu_supports("avx2"))
+            return stream_blocks_avx2;
+        return stream_blocks_sse2;
+    }();
+
+    size_t head = (64 - reinterpret_cast<uintptr_t>(dst) % 64) % 64;
+    if (head >= size) {
+        std::memcpy(dst, src, size);
+        return;
+    }
+    std::memcpy(dst, src, head);
+    size_t blocks = (size - head) / 256;
+    stream_blocks(dst + head, src + head, blocks);
+    _mm_sfence();
+    size_t done = head + blocks * 256;
+    std::memcpy(dst + done, src + done, size - done);
+}
+
+static inline auto copy_frame(std::byte *dst, const std::byte *src, size_t size, const copy_policy &policy) -> void {
+    if (policy.engine == copy_engine::streaming && size >= policy.threshold)
+        streaming_copy(dst, src, size);
+    else
+        std::memcpy(dst, src, size);
+}
+
+#endif
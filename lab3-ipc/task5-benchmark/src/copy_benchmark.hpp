@@ -0,0 +1,82 @@
+#pragma once
+
+#ifndef COPY_BENCHMARK_H
+#define COPY_BENCHMARK_H
+
+#include "copy.hpp"
+#include "frame.hpp"
+#include "options.hpp"
+#include "report.hpp"
+#include <chrono>
+#include <unistd.h>
+
+// --mode=copy: copies frames with each engine and no transport in between.
+// Sources rotate through an arena bigger than the last-level cache, like
+// frames freshly written by another process. After every copy the reader's
+// working set, half of L2, is walked once. That walk slows down as soon as
+// the copies start to evict it, which is the cost the nt engine avoids.
+constexpr size_t copy_arena_size = 256 << 20;
+
+static inline auto walk_working_set(const std::byte *data, size_t size) -> uint64_t {
+    uint64_t sum = 0;
+    for (size_t offset = 0; offset < size; offset += 64) {
+        uint64_t word;
+        std::memcpy(&word, data + offset, sizeof(word));
+        sum += word;
+    }
+    return sum;
+}
+
+static inline auto run_copy_benchmark(const options &opts, reporter &output) -> void {
+    const size_t working_set_size = default_copy_threshold();
+    frame_ptr arena = allocate_frame(copy_arena_size);
+    frame_ptr working_set = allocate_frame(working_set_size);
+    generate_frame(arena.get(), copy_arena_size, generating_seed);
+    generate_frame(working_set.get(), working_set_size, generating_seed);
+    [[maybe_unused]] volatile uint64_t sink = 0;
+
+    for (size_t frame_size : opts.frame_sizes) {
+        if (frame_size > copy_arena_size / 2) {
+            std::cerr << std::format("Skipping copy of {} B: larger than half the {} B arena", frame_size, copy_arena_size) << std::endl;
+            continue;
+        }
+        frame_ptr destination = allocate_frame(frame_size);
+        const size_t stride = (frame_size + page_size - 1) / page_size * page_size;
+        const size_t slots = copy_arena_size / stride;
+
+        for (copy_engine engine : {copy_engine::libc, copy_engine::streaming}) {
+            // The threshold only decides what the transports hand to the nt
+            // engine; here every size goes through the engine under test.
+            const copy_policy policy{engine, 0};
+            auto source = [&](size_t i) { return arena.get() + i % slots * stride; };
+
+            for (size_t i = 0; i < opts.warmup; ++i)
+                copy_frame(destination.get(), source(i), frame_size, policy);
+            auto start_time = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < opts.rounds; ++i)
+                copy_frame(destination.get(), source(i), frame_size, policy);
+            std::chrono::duration<double> copy_elapsed = std::chrono::high_resolution_clock::now() - start_time;
+
+            std::chrono::duration<double> walk_elapsed{0};
+            for (size_t i = 0; i < opts.rounds; ++i) {
+                copy_frame(destination.get(), source(i), frame_size, policy);
+                auto walk_start = std::chrono::high_resolution_clock::now();
+                sink = sink + walk_working_set(working_set.get(), working_set_size);
+                walk_elapsed += std::chrono::high_resolution_clock::now() - walk_start;
+            }
+
+            record result;
+            result.add("mode", mode_name(opts.mode))
+                .add("engine", copy_engine_name(engine))
+                .add("frame_size", static_cast<uint64_t>(frame_size))
+                .add("rounds", static_cast<uint64_t>(opts.rounds))
+                .add("copy_ns", copy_elapsed.count() * 1e9 / opts.rounds)
+                .add("copy_mib_s", opts.rounds * frame_size / (1024.0 * 1024.0) / copy_elapsed.count())
+                .add("working_set", static_cast<uint64_t>(working_set_size))
+                .add("working_set_walk_ns", walk_elapsed.count() * 1e9 / opts.rounds);
+            output.add(result);
+        }
+    }
+}
+
+#endif
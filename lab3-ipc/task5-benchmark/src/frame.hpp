@@ -0,0 +1,222 @@
+#pragma once
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "crc32c.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <immintrin.h>
+#include <memory>
+
+constexpr uint64_t generating_seed = 2022212720;
+constexpr size_t page_size = 1 << 12;
+
+struct free_deleter {
+    auto operator()(std::byte *data) const -> void { std::free(data); }
+};
+
+using frame_ptr = std::unique_ptr<std::byte[], free_deleter>;
+
+// Page-aligned so that the same buffers can be handed to vmsplice, O_DIRECT
+// style interfaces or vector stores without another copy.
+static inline auto allocate_frame(size_t size) -> frame_ptr {
+    size_t rounded = (size + page_size - 1) / page_size * page_size;
+    auto data = static_cast<std::byte *>(std::aligned_alloc(page_size, rounded ? rounded : page_size));
+    if (data == nullptr) {
+        perror("aligned_alloc");
+        exit(EXIT_FAILURE);
+    }
+    return frame_ptr(data);
+}
+
+// Frames carry a 64-bit arithmetic sequence that starts at a seed-derived
+// value: word i of the frame with seed s is base(s) + i * step, stored little
+// endian. Unlike a single repeated byte, misplaced or stale words show up,
+// and the sequence can be regenerated on the fly with one vector add per
+// store, so verifying needs no second buffer.
+constexpr uint64_t pattern_step = 0x9E3779B97F4A7C15;
+
+static inline auto pattern_base(uint64_t seed) -> uint64_t {
+    return (seed ^ (seed >> 31)) * 0xBF58476D1CE4E5B9;
+}
+
+static inline auto pattern_word(uint64_t seed, size_t index) -> uint64_t {
+    return pattern_base(seed) + index * pattern_step;
+}
+
+static inline auto pattern_byte(uint64_t seed, size_t offset) -> std::byte {
+    return static_cast<std::byte>(pattern_word(seed, offset / 8) >> (offset % 8 * 8));
+}
+
+// Kernels over whole words: out[i] or in[i] holds pattern word first + i.
+struct pattern_kernels {
+    const char *name;
+    void (*generate)(std::byte *out, size_t count, uint64_t seed, size_t first, bool streaming);
+    bool (*verify)(const std::byte *in, size_t count, uint64_t seed, size_t first);
+};
+
+static inline auto generate_words_scalar(std::byte *out, size_t count, uint64_t seed, size_t first, bool) -> void {
+    uint64_t word = pattern_word(seed, first);
+    for (size_t i = 0; i < count; ++i, word += pattern_step)
+        std::memcpy(out + i * 8, &word, 8);
+}
+
+static inline auto verify_words_scalar(const std::byte *in, size_t count, uint64_t seed, size_t first) -> bool {
+    uint64_t word = pattern_word(seed, first), difference = 0;
+    for (size_t i = 0; i < count; ++i, word += pattern_step) {
+        uint64_t actual;
+        std::memcpy(&actual, in + i * 8, 8);
+        difference |= actual ^ word;
+    }
+    return difference == 0;
+}
+
+// Non-temporal stores need aligned addresses; words before the first
+// aligned one go through the scalar path.
+template <size_t alignment>
+static inline auto align_prologue(std::byte *out, size_t count) -> size_t {
+    size_t misalignment = reinterpret_cast<uintptr_t>(out) % alignment;
+    if (misalignment % 8)
+        return SIZE_MAX; // not even word aligned, stay with regular stores
+    return std::min(count, misalignment ? (alignment - misalignment) / 8 : 0);
+}
+
+__attribute__((target("avx2"))) static inline auto generate_words_avx2(std::byte *out, size_t count, uint64_t seed, size_t first, bool streaming) -> void {
+    size_t i = 0;
+    if (streaming) {
+        size_t head = align_prologue<32>(out, count);
+        if (head == SIZE_MAX)
+            streaming = false;
+        else {
+            generate_words_scalar(out, head, seed, first, false);
+            i = head;
+        }
+    }
+    uint64_t start = pattern_word(seed, first + i);
+    __m256i words = _mm256_add_epi64(_mm256_set1_epi64x(start),
+                                     _mm256_set_epi64x(3 * pattern_step, 2 * pattern_step, pattern_step, 0));
+    const __m256i advance = _mm256_set1_epi64x(4 * pattern_step);
+    if (streaming) {
+        for (; i + 4 <= count; i += 4, words = _mm256_add_epi64(words, advance))
+            _mm256_stream_si256(reinterpret_cast<__m256i *>(out + i * 8), words);
+        _mm_sfence();
+    } else
+        for (; i + 4 <= count; i += 4, words = _mm256_add_epi64(words, advance))
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i * 8), words);
+    generate_words_scalar(out + i * 8, count - i, seed, first + i, false);
+}
+
+__attribute__((target("avx2"))) static inline auto verify_words_avx2(const std::byte *in, size_t count, uint64_t seed, size_t first) -> bool {
+    __m256i words = _mm256_add_epi64(_mm256_set1_epi64x(pattern_word(seed, first)),
+                                     _mm256_set_epi64x(3 * pattern_step, 2 * pattern_step, pattern_step, 0));
+    const __m256i advance = _mm256_set1_epi64x(4 * pattern_step);
+    __m256i difference = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4, words = _mm256_add_epi64(words, advance)) {
+        __m256i actual = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i * 8));
+        difference = _mm256_or_si256(difference, _mm256_xor_si256(actual, words));
+    }
+    return _mm256_testz_si256(difference, difference) && verify_words_scalar(in + i * 8, count - i, seed, first + i);
+}
+
+__attribute__((target("avx512f"))) static inline auto lane_offsets_avx512() -> __m512i {
+    return _mm512_set_epi64(7 * pattern_step, 6 * pattern_step, 5 * pattern_step, 4 * pattern_step,
+                            3 * pattern_step, 2 * pattern_step, pattern_step, 0);
+}
+
+__attribute__((target("avx512f"))) static inline auto generate_words_avx512(std::byte *out, size_t count, uint64_t seed, size_t first, bool streaming) -> void {
+    size_t i = 0;
+    if (streaming) {
+        size_t head = align_prologue<64>(out, count);
+        if (head == SIZE_MAX)
+            streaming = false;
+        else {
+            generate_words_scalar(out, head, seed, first, false);
+            i = head;
+        }
+    }
+    __m512i words = _mm512_add_epi64(_mm512_set1_epi64(pattern_word(seed, first + i)),
+                                     lane_offsets_avx512());
+    const __m512i advance = _mm512_set1_epi64(8 * pattern_step);
+    if (streaming) {
+        for (; i + 8 <= count; i += 8, words = _mm512_add_epi64(words, advance))
+            _mm512_stream_si512(reinterpret_cast<__m512i *>(out + i * 8), words);
+        _mm_sfence();
+    } else
+        for (; i + 8 <= count; i += 8, words = _mm512_add_epi64(words, advance))
+            _mm512_storeu_si512(out + i * 8, words);
+    generate_words_scalar(out + i * 8, count - i, seed, first + i, false);
+}
+
+__attribute__((target("avx512f"))) static inline auto verify_words_avx512(const std::byte *in, size_t count, uint64_t seed, size_t first) -> bool {
+    __m512i words = _mm512_add_epi64(_mm512_set1_epi64(pattern_word(seed, first)),
+                                     lane_offsets_avx512());
+    const __m512i advance = _mm512_set1_epi64(8 * pattern_step);
+    __m512i difference = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8, words = _mm512_add_epi64(words, advance))
+        difference = _mm512_or_si512(difference, _mm512_xor_si512(_mm512_loadu_si512(in + i * 8), words));
+    return _mm512_test_epi64_mask(difference, difference) == 0 && verify_words_scalar(in + i * 8, count - i, seed, first + i);
+}
+
+// Picked once from what the CPU supports.
+static inline auto kernels() -> const pattern_kernels & {
+    static const pattern_kernels selected = [] {
+        if (__builtin_cpu_supports("avx512f"))
+            return pattern_kernels{"avx512", generate_words_avx512, verify_words_avx512};
+        if (__builtin_cpu_supports("avx2"))
+            return pattern_kernels{"avx2", generate_words_avx2, verify_words_avx2};
+        return pattern_kernels{"scalar", generate_words_scalar, verify_words_scalar};
+    }();
+    return selected;
+}
+
+// With `streaming` the words bypass the cache, which suits a writer whose
+// frame is read by another core rather than by itself.
+static inline auto generate_frame(std::byte *data, size_t size, uint64_t seed, bool streaming = false) -> void {
+    kernels().generate(data, size / 8, seed, 0, streaming);
+    for (size_t offset = size / 8 * 8; offset < size; ++offset)
+        data[offset] = pattern_byte(seed, offset);
+}
+
+// Checks bytes [from, size) against the pattern generate_frame() wrote.
+static inline auto verify_frame(const std::byte *data, size_t size, uint64_t seed, size_t from = 0) -> bool {
+    size_t first_word = std::min((from + 7) / 8, size / 8);
+    for (size_t offset = from; offset < std::min(first_word * 8, size); ++offset)
+        if (data[offset] != pattern_byte(seed, offset))
+            return false;
+    if (!kernels().verify(data + first_word * 8, size / 8 - first_word, seed, first_word))
+        return false;
+    for (size_t offset = std::max(size / 8 * 8, from); offset < size; ++offset)
+        if (data[offset] != pattern_byte(seed, offset))
+            return false;
+    return true;
+}
+
+// The last four bytes of a sealed frame hold the CRC32C of everything before
+// them, chained from the seed so that a frame arriving in the wrong place
+// fails as well.
+constexpr size_t digest_size = sizeof(uint32_t);
+
+static inline auto frame_digest(const std::byte *data, size_t size, uint64_t seed) -> uint32_t {
+    auto chained = static_cast<uint32_t>(seed ^ (seed >> 32));
+    return crc32c(chained, data, size - digest_size);
+}
+
+static inline auto seal_frame(std::byte *data, size_t size, uint64_t seed) -> void {
+    uint32_t digest = frame_digest(data, size, seed);
+    std::memcpy(data + size - digest_size, &digest, digest_size);
+}
+
+static inline auto check_digest(const std::byte *data, size_t size, uint64_t seed) -> bool {
+    uint32_t digest;
+    std::memcpy(&digest, data + size - digest_size, digest_size);
+    return digest == frame_digest(data, size, seed);
+}
+
+#endif
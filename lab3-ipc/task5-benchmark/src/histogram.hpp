@@ -0,0 +1,122 @@
+#pragma once
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// The clock latency samples are taken with. CLOCK_MONOTONIC is shared by all
+// processes, so a stamp from one side can be compared on the other.
+static inline auto monotonic_ns() -> uint64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Log-bucketed latency histogram in the spirit of HdrHistogram. Values below
+// 64 ns are counted exactly, larger values land in one of 32 linear
+// sub-buckets per power of two, so every bucket is within ~3% of the values
+// it holds. The object is trivially copyable and can live in shared memory.
+class latency_histogram {
+  private:
+    static constexpr size_t sub_bucket_bits = 6;
+    static constexpr size_t sub_buckets = 1 << sub_bucket_bits;
+    static constexpr size_t half_buckets = sub_buckets / 2;
+    static constexpr size_t bucket_count = sub_buckets + (64 - sub_bucket_bits + 1) * half_buckets;
+
+    uint64_t counts[bucket_count];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t maximum;
+
+    static auto index_of(uint64_t value) -> size_t {
+        if (value < sub_buckets)
+            return value;
+        size_t shift = std::bit_width(value) - sub_bucket_bits;
+        size_t mantissa = value >> shift;
+        return sub_buckets + (shift - 1) * half_buckets + (mantissa - half_buckets);
+    }
+
+    static auto highest_value_of(size_t index) -> uint64_t {
+        if (index < sub_buckets)
+            return index;
+        size_t shift = (index - sub_buckets) / half_buckets + 1;
+        uint64_t mantissa = (index - sub_buckets) % half_buckets + half_buckets;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+  public:
+    latency_histogram() {
+        reset();
+    }
+
+    auto reset() -> void {
+        std::fill(counts, counts + bucket_count, 0);
+        total = sum = maximum = 0;
+    }
+
+    auto record(uint64_t value) -> void {
+        ++counts[index_of(value)];
+        ++total;
+        sum += value;
+        maximum = std::max(maximum, value);
+    }
+
+    auto merge(const latency_histogram &other) -> void {
+        for (size_t i = 0; i < bucket_count; ++i)
+            counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        maximum = std::max(maximum, other.maximum);
+    }
+
+    // Coarse view for printing: (bound, count) for every non-empty power of
+    // two, counting the values in [bound / 2, bound). Sub-buckets never
+    // straddle a power of two, so the regrouping is exact.
+    auto power_of_two_counts() const -> std::vector<std::pair<uint64_t, uint64_t>> {
+        std::vector<std::pair<uint64_t, uint64_t>> result;
+        for (size_t i = 0; i < bucket_count; ++i) {
+            if (counts[i] == 0)
+                continue;
+            uint64_t bound = uint64_t{1} << std::bit_width(highest_value_of(i));
+            if (result.empty() || result.back().first != bound)
+                result.emplace_back(bound, 0);
+            result.back().second += counts[i];
+        }
+        return result;
+    }
+
+    auto count() const -> uint64_t {
+        return total;
+    }
+
+    auto max() const -> uint64_t {
+        return maximum;
+    }
+
+    auto mean() const -> double {
+        return total ? static_cast<double>(sum) / total : 0;
+    }
+
+    auto percentile(double p) const -> uint64_t {
+        if (total == 0)
+            return 0;
+        uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p / 100 * total)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < bucket_count; ++i) {
+            seen += counts[i];
+            if (seen >= target)
+                return std::min(highest_value_of(i), maximum);
+        }
+        return maximum;
+    }
+};
+
+#endif
@@ -0,0 +1,453 @@
+#include "copy_benchmark.hpp"
+#include "frame.hpp"
+#include "histogram.hpp"
+#include "options.hpp"
+#include "placement.hpp"
+#include "report.hpp"
+#include "transport.hpp"
+#include "transports.hpp"
+#include "wakeup_benchmark.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <format>
+#include <initializer_list>
+#include <iostream>
+#include <optional>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+struct side_result {
+    double seconds;
+    uint64_t mismatches;
+    latency_histogram latency;
+    std::optional<uint64_t> syscalls; // during the measured frames
+    uint64_t cpu_ns;                  // CPU time of the whole process, user and system, ditto
+    uint64_t reordered;               // tagged frames that arrived after a later one
+    latency_histogram priority_latency[max_priority_classes]; // by priority_classes() index
+};
+
+// Kernel work done on behalf of a send, such as loopback TCP processing,
+// is charged to whichever process it runs in, so per-side CPU time is the
+// fairer cost measure than wall time.
+static inline auto process_cpu_ns() -> uint64_t {
+    timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec * 1'000'000'000ull + now.tv_nsec;
+}
+
+// In stream mode the first eight bytes of every frame carry the send time,
+// so only the rest of the frame is compared against the generated pattern.
+static inline auto timestamp_size(const options &opts) -> size_t {
+    return opts.mode == benchmark_mode::stream ? sizeof(uint64_t) : 0;
+}
+
+// Sums the syscall counters of the given transports, if all of them count.
+static inline auto syscall_count(std::initializer_list<const transport *> channels) -> std::optional<uint64_t> {
+    uint64_t total = 0;
+    for (const transport *channel : channels) {
+        auto calls = channel->syscalls();
+        if (!calls)
+            return std::nullopt;
+        total += *calls;
+    }
+    return total;
+}
+
+static inline auto syscalls_since(std::optional<uint64_t> start, std::optional<uint64_t> end) -> std::optional<uint64_t> {
+    if (!start || !end)
+        return std::nullopt;
+    return *end - *start;
+}
+
+// With mixed priorities frames can overtake each other, so the writer stores
+// each frame's sequence number right after any timestamp and the reader
+// checks frames against that rather than against their arrival order.
+static inline auto tags_sequence(const transport &channel, const run_config &config) -> bool {
+    return channel.prioritises_frames() && priority_classes(config.mq_priorities).size() > 1;
+}
+
+static inline auto header_size(const options &opts, bool tagged) -> size_t {
+    return timestamp_size(opts) + (tagged ? sizeof(uint64_t) : 0);
+}
+
+static inline auto priority_class(const std::vector<unsigned> &classes, unsigned priority) -> size_t {
+    return std::lower_bound(classes.begin(), classes.end(), priority) - classes.begin();
+}
+
+// Accepts a tagged frame if it names a frame not delivered before and came
+// at the priority that frame was scheduled for.
+class sequence_check {
+  private:
+    std::vector<bool> seen;
+    uint64_t highest = 0;
+
+  public:
+    explicit sequence_check(size_t frames) : seen(frames) {}
+
+    auto accept(uint64_t sequence, unsigned priority, const run_config &config, side_result &result) -> bool {
+        if (sequence >= seen.size() || seen[sequence] || priority != scheduled_priority(config, sequence))
+            return false;
+        seen[sequence] = true;
+        if (sequence < highest)
+            ++result.reordered;
+        highest = std::max(highest, sequence);
+        return true;
+    }
+};
+
+static inline auto frame_intact(const std::byte *data, size_t size, uint64_t seed, const options &opts, bool tagged) -> bool {
+    switch (opts.verify) {
+    case verify_mode::pattern:
+        return verify_frame(data, size, seed, header_size(opts, tagged));
+    case verify_mode::digest:
+        return check_digest(data, size, seed);
+    default:
+        return true;
+    }
+}
+
+static inline auto run_writer(transport &channel, const run_config &config, const options &opts, side_result &result) -> void {
+    const bool tagged = tags_sequence(channel, config);
+    channel.attach(role::writer);
+    auto start_time = std::chrono::high_resolution_clock::now();
+    uint64_t start_cpu = process_cpu_ns();
+    auto start_calls = syscall_count({&channel});
+
+    for (size_t i = 0; i < config.frames; ++i) {
+        if (i == opts.warmup) {
+            start_time = std::chrono::high_resolution_clock::now();
+            start_cpu = process_cpu_ns();
+            start_calls = syscall_count({&channel});
+        }
+
+        std::byte *data = channel.begin_send();
+        generate_frame(data, config.frame_size, generating_seed + i, opts.streaming_stores);
+        if (opts.mode == benchmark_mode::stream) {
+            uint64_t now = monotonic_ns();
+            std::memcpy(data, &now, sizeof(now));
+        }
+        if (tagged) {
+            uint64_t sequence = i;
+            std::memcpy(data + timestamp_size(opts), &sequence, sizeof(sequence));
+        }
+        if (opts.verify == verify_mode::digest)
+            seal_frame(data, config.frame_size, generating_seed + i);
+        channel.end_send();
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    uint64_t end_cpu = process_cpu_ns();
+    channel.detach(role::writer);
+    result.syscalls = syscalls_since(start_calls, syscall_count({&channel}));
+
+    std::chrono::duration<double> total_elapsed = end_time - start_time;
+    result.seconds = total_elapsed.count();
+    result.cpu_ns = end_cpu - start_cpu;
+}
+
+static inline auto run_reader(transport &channel, const run_config &config, const options &opts, side_result &result) -> void {
+    const bool tagged = tags_sequence(channel, config);
+    const auto classes = priority_classes(config.mq_priorities);
+    sequence_check order(tagged ? config.frames : 0);
+    channel.attach(role::reader);
+    auto start_time = std::chrono::high_resolution_clock::now();
+    uint64_t start_cpu = process_cpu_ns();
+    auto start_calls = syscall_count({&channel});
+
+    for (size_t i = 0; i < config.frames; ++i) {
+        if (i == opts.warmup) {
+            start_time = std::chrono::high_resolution_clock::now();
+            start_cpu = process_cpu_ns();
+            start_calls = syscall_count({&channel});
+        }
+
+        const std::byte *data = channel.begin_receive();
+        uint64_t sequence = i;
+        if (tagged) {
+            std::memcpy(&sequence, data + timestamp_size(opts), sizeof(sequence));
+            if (!order.accept(sequence, channel.received_priority(), config, result)) {
+                ++result.mismatches;
+                channel.end_receive();
+                continue;
+            }
+        }
+        if (opts.mode == benchmark_mode::stream && i >= opts.warmup) {
+            uint64_t sent;
+            std::memcpy(&sent, data, sizeof(sent));
+            uint64_t latency = monotonic_ns() - sent;
+            result.latency.record(latency);
+            if (tagged)
+                result.priority_latency[priority_class(classes, channel.received_priority())].record(latency);
+        }
+        if (!frame_intact(data, config.frame_size, generating_seed + sequence, opts, tagged))
+            ++result.mismatches;
+        channel.end_receive();
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    uint64_t end_cpu = process_cpu_ns();
+    channel.detach(role::reader);
+    result.syscalls = syscalls_since(start_calls, syscall_count({&channel}));
+
+    std::chrono::duration<double> total_elapsed = end_time - start_time;
+    result.seconds = total_elapsed.count();
+    result.cpu_ns = end_cpu - start_cpu;
+}
+
+// The writer times each frame from handing it to the forward channel until
+// the reader's echo has arrived on the backward channel.
+static inline auto run_pingpong_writer(transport &forward, transport &backward, const run_config &config, const options &opts, side_result &result) -> void {
+    const bool tagged = tags_sequence(forward, config);
+    const auto classes = priority_classes(config.mq_priorities);
+    forward.attach(role::writer);
+    backward.attach(role::reader);
+    auto start_time = std::chrono::high_resolution_clock::now();
+    uint64_t start_cpu = process_cpu_ns();
+    auto start_calls = syscall_count({&forward, &backward});
+
+    for (size_t i = 0; i < config.frames; ++i) {
+        if (i == opts.warmup) {
+            start_time = std::chrono::high_resolution_clock::now();
+            start_cpu = process_cpu_ns();
+            start_calls = syscall_count({&forward, &backward});
+        }
+
+        std::byte *data = forward.begin_send();
+        generate_frame(data, config.frame_size, generating_seed + i, opts.streaming_stores);
+        if (tagged) {
+            uint64_t sequence = i;
+            std::memcpy(data, &sequence, sizeof(sequence));
+        }
+        if (opts.verify == verify_mode::digest)
+            seal_frame(data, config.frame_size, generating_seed + i);
+        uint64_t sent = monotonic_ns();
+        forward.end_send();
+
+        backward.begin_receive();
+        backward.end_receive();
+        if (i >= opts.warmup) {
+            uint64_t latency = monotonic_ns() - sent;
+            result.latency.record(latency);
+            if (tagged)
+                result.priority_latency[priority_class(classes, scheduled_priority(config, i))].record(latency);
+        }
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    uint64_t end_cpu = process_cpu_ns();
+    forward.detach(role::writer);
+    backward.detach(role::reader);
+    result.syscalls = syscalls_since(start_calls, syscall_count({&forward, &backward}));
+
+    std::chrono::duration<double> total_elapsed = end_time - start_time;
+    result.seconds = total_elapsed.count();
+    result.cpu_ns = end_cpu - start_cpu;
+}
+
+static inline auto run_pingpong_reader(transport &forward, transport &backward, const run_config &config, const options &opts, side_result &result) -> void {
+    const bool tagged = tags_sequence(forward, config);
+    sequence_check order(tagged ? config.frames : 0);
+    forward.attach(role::reader);
+    backward.attach(role::writer);
+    auto start_time = std::chrono::high_resolution_clock::now();
+    uint64_t start_cpu = process_cpu_ns();
+    auto start_calls = syscall_count({&forward, &backward});
+
+    for (size_t i = 0; i < config.frames; ++i) {
+        if (i == opts.warmup) {
+            start_time = std::chrono::high_resolution_clock::now();
+            start_cpu = process_cpu_ns();
+            start_calls = syscall_count({&forward, &backward});
+        }
+
+        const std::byte *data = forward.begin_receive();
+        uint64_t sequence = i;
+        if (tagged)
+            std::memcpy(&sequence, data, sizeof(sequence));
+        if (tagged && !order.accept(sequence, forward.received_priority(), config, result))
+            ++result.mismatches;
+        else if (!frame_intact(data, config.frame_size, generating_seed + sequence, opts, tagged))
+            ++result.mismatches;
+        std::byte *reply = backward.begin_send();
+        copy_frame(reply, data, config.frame_size, config.copy);
+        forward.end_receive();
+        backward.end_send();
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    uint64_t end_cpu = process_cpu_ns();
+    forward.detach(role::reader);
+    backward.detach(role::writer);
+    result.syscalls = syscalls_since(start_calls, syscall_count({&forward, &backward}));
+
+    std::chrono::duration<double> total_elapsed = end_time - start_time;
+    result.seconds = total_elapsed.count();
+    result.cpu_ns = end_cpu - start_cpu;
+}
+
+static inline auto per_frame(std::optional<uint64_t> calls, size_t rounds) -> std::optional<double> {
+    if (!calls)
+        return std::nullopt;
+    return static_cast<double>(*calls) / rounds;
+}
+
+// "7:n=../p50=../p99=.. 0:n=.." with the most urgent priority first, or "-"
+// when the run did not measure latency per priority.
+static inline auto priority_latency_summary(const side_result &result, const run_config &config) -> std::string {
+    auto classes = priority_classes(config.mq_priorities);
+    std::string summary;
+    for (size_t c = classes.size(); c-- > 0;) {
+        const latency_histogram &latency = result.priority_latency[c];
+        if (latency.count())
+            summary += std::format("{}{}:n={}/p50={}/p99={}", summary.empty() ? "" : " ", classes[c], latency.count(),
+                                   latency.percentile(50), latency.percentile(99));
+    }
+    return summary.empty() ? "-" : summary;
+}
+
+static inline auto benchmark(std::string_view name, const run_config &config, const run_placement &place, const options &opts) -> std::optional<record> {
+    const size_t frame_size = config.frame_size;
+    auto forward = make_transport(name);
+    auto backward = make_transport(name);
+    if (frame_size > forward->max_frame_size()) {
+        std::cerr
+            << std::format("Skipping {}: frame size {} B exceeds its limit of {} B", name, frame_size, forward->max_frame_size())
+            << std::endl;
+        return std::nullopt;
+    }
+
+    const bool pingpong = opts.mode == benchmark_mode::pingpong;
+    forward->setup(config);
+    if (pingpong)
+        backward->setup(config);
+
+    void *shared_result = mmap(nullptr, sizeof(side_result), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared_result == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    side_result *reader_result = new (shared_result) side_result{};
+    side_result *writer_result = new side_result{};
+
+    std::cout << std::flush;
+    auto pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        if (place.cpus)
+            pin_to(place.cpus->reader);
+        if (pingpong)
+            run_pingpong_reader(*forward, *backward, config, opts, *reader_result);
+        else
+            run_reader(*forward, config, opts, *reader_result);
+        exit(EXIT_SUCCESS);
+    }
+
+    cpu_set_t original_affinity = current_affinity();
+    if (place.cpus)
+        pin_to(place.cpus->writer);
+    if (pingpong)
+        run_pingpong_writer(*forward, *backward, config, opts, *writer_result);
+    else
+        run_writer(*forward, config, opts, *writer_result);
+
+    int status;
+    if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+        std::cerr << std::format("Reader for {} did not finish cleanly", name) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    restore_affinity(original_affinity);
+    forward->teardown();
+    if (pingpong)
+        backward->teardown();
+
+    const latency_histogram &latency = pingpong ? writer_result->latency : reader_result->latency;
+    const double mebibytes = opts.rounds * frame_size / (1024.0 * 1024.0);
+    record result;
+    result.add("transport", name)
+        .add("mode", mode_name(opts.mode))
+        .add("frame_size", static_cast<uint64_t>(frame_size))
+        .add("pages", forward->pages())
+        .add("settings", forward->settings())
+        .add("placement", placement_name(place.where))
+        .add("cpus", place.cpus ? std::format("{}/{}", place.cpus->writer, place.cpus->reader) : "-")
+        .add("rounds", static_cast<uint64_t>(opts.rounds))
+        .add("warmup", static_cast<uint64_t>(opts.warmup))
+        .add("writer_seconds", writer_result->seconds)
+        .add("writer_mib_s", mebibytes / writer_result->seconds)
+        .add("reader_seconds", reader_result->seconds)
+        .add("reader_mib_s", mebibytes / reader_result->seconds)
+        .add("frames_per_second", opts.rounds / reader_result->seconds)
+        .add("latency_mean_ns", latency.mean())
+        .add("latency_p50_ns", latency.percentile(50))
+        .add("latency_p99_ns", latency.percentile(99))
+        .add("latency_p999_ns", latency.percentile(99.9))
+        .add("latency_max_ns", latency.max())
+        .add("latency_by_priority", priority_latency_summary(pingpong ? *writer_result : *reader_result, config))
+        .add("reordered_frames", reader_result->reordered)
+        .add("writer_syscalls_per_frame", per_frame(writer_result->syscalls, opts.rounds))
+        .add("reader_syscalls_per_frame", per_frame(reader_result->syscalls, opts.rounds))
+        .add("writer_cpu_ns_per_frame", static_cast<double>(writer_result->cpu_ns) / opts.rounds)
+        .add("reader_cpu_ns_per_frame", static_cast<double>(reader_result->cpu_ns) / opts.rounds)
+        .add("verify", verify_name(opts.verify))
+        .add("mismatches", reader_result->mismatches);
+
+    delete writer_result;
+    munmap(shared_result, sizeof(side_result));
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    options opts = parse_options(argc, argv);
+    reporter output(opts.format);
+    if (opts.mode == benchmark_mode::copy) {
+        run_copy_benchmark(opts, output);
+        return 0;
+    }
+
+    // Classes this machine cannot provide are reported once and dropped.
+    std::vector<run_placement> placements;
+    auto topology = discover_topology();
+    for (placement where : opts.placements) {
+        auto cpus = pick_cpus(topology, where);
+        if (where != placement::none && !cpus)
+            std::cerr << std::format("Skipping placement {}: no such pair of CPUs available", placement_name(where)) << std::endl;
+        else
+            placements.push_back({where, cpus});
+    }
+    if (opts.mode == benchmark_mode::wakeup) {
+        run_wakeup_benchmark(opts, placements, output);
+        return 0;
+    }
+
+    for (const auto &name : opts.transports) {
+        auto probe = make_transport(name);
+        std::vector<page_policy> pages{page_policy::base};
+        if (probe->maps_frames())
+            pages = opts.pages;
+        std::vector<size_t> queue_depths{run_config{}.queue_depth};
+        if (probe->queues_frames())
+            queue_depths = opts.queue_depths;
+
+        for (size_t frame_size : opts.frame_sizes)
+            for (page_policy page : pages)
+                for (size_t queue_depth : queue_depths)
+                    for (const auto &place : placements) {
+                        run_config config{frame_size, opts.warmup + opts.rounds, page, queue_depth, opts.sqpoll, opts.copy,
+                                          opts.mq_priorities, opts.send_buffer, opts.receive_buffer,
+                                          opts.mode == benchmark_mode::pingpong, opts.tcp_nodelay, opts.busy_poll};
+                        if (auto result = benchmark(name, config, place, opts))
+                            output.add(*result);
+                    }
+    }
+
+    return 0;
+}
@@ -0,0 +1,306 @@
+#pragma once
+
+#ifndef NOTIFIER_H
+#define NOTIFIER_H
+
+#include "transport.hpp"
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// A wake-up path between two processes and nothing else: no payload, only
+// "you may run now". setup() runs in the parent before fork(), attach() in
+// both processes with the other one's pid, teardown() in the parent after
+// the child has exited. notify() wakes the peer, wait() sleeps until the
+// peer has notified this side. The two sides take turns, so at most one
+// notification per direction is ever outstanding.
+class notifier {
+  public:
+    virtual ~notifier() = default;
+
+    virtual auto setup() -> void = 0;
+    virtual auto attach(role side, pid_t peer) -> void = 0;
+    virtual auto notify() -> void = 0;
+    virtual auto wait() -> void = 0;
+    virtual auto teardown() -> void = 0;
+};
+
+// One byte written into a pipe per notification.
+class pipe_notifier : public notifier {
+  private:
+    int forward[2] = {-1, -1};  // writer to reader
+    int backward[2] = {-1, -1}; // reader to writer
+    int out = -1;
+    int in = -1;
+
+  public:
+    auto setup() -> void override {
+        if (pipe2(forward, O_CLOEXEC) == -1 || pipe2(backward, O_CLOEXEC) == -1) {
+            perror("pipe2");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    auto attach(role side, [[maybe_unused]] pid_t peer) -> void override {
+        bool writer = side == role::writer;
+        out = writer ? forward[1] : backward[1];
+        in = writer ? backward[0] : forward[0];
+        close(writer ? forward[0] : backward[0]);
+        close(writer ? backward[1] : forward[1]);
+    }
+
+    auto notify() -> void override {
+        char byte = 0;
+        while (write(out, &byte, 1) != 1)
+            if (errno != EINTR) {
+                perror("write pipe");
+                exit(EXIT_FAILURE);
+            }
+    }
+
+    auto wait() -> void override {
+        char byte;
+        while (read(in, &byte, 1) != 1)
+            if (errno != EINTR) {
+                perror("read pipe");
+                exit(EXIT_FAILURE);
+            }
+    }
+
+    auto teardown() -> void override {
+        close(out);
+        close(in);
+    }
+};
+
+// An eventfd per direction, incremented by notify() and drained by wait().
+class eventfd_notifier : public notifier {
+  private:
+    int forward = -1;
+    int backward = -1;
+    int out = -1;
+    int in = -1;
+
+  public:
+    auto setup() -> void override {
+        forward = eventfd(0, EFD_CLOEXEC);
+        backward = eventfd(0, EFD_CLOEXEC);
+        if (forward == -1 || backward == -1) {
+            perror("eventfd");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    auto attach(role side, [[maybe_unused]] pid_t peer) -> void override {
+        out = side == role::writer ? forward : backward;
+        in = side == role::writer ? backward : forward;
+    }
+
+    auto notify() -> void override {
+        if (eventfd_write(out, 1) == -1) {
+            perror("eventfd_write");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    auto wait() -> void override {
+        eventfd_t value;
+        while (eventfd_read(in, &value) == -1)
+            if (errno != EINTR) {
+                perror("eventfd_read");
+                exit(EXIT_FAILURE);
+            }
+    }
+
+    auto teardown() -> void override {
+        close(forward);
+        close(backward);
+    }
+};
+
+// A flag per direction in a shared page. notify() always issues FUTEX_WAKE,
+// so the measurement covers the kernel wake path even when the waiter has
+// not gone to sleep yet.
+class futex_notifier : public notifier {
+  private:
+    std::atomic<uint32_t> *flags = nullptr; // [0] writer to reader, [1] back
+    std::atomic<uint32_t> *out = nullptr;
+    std::atomic<uint32_t> *in = nullptr;
+
+    static auto futex(std::atomic<uint32_t> *word, int op, uint32_t value) -> long {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), op, value, nullptr, nullptr, 0);
+    }
+
+  public:
+    auto setup() -> void override {
+        void *memory = mmap(nullptr, getpagesize(), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            perror("mmap");
+            exit(EXIT_FAILURE);
+        }
+        flags = new (memory) std::atomic<uint32_t>[2]{};
+    }
+
+    auto attach(role side, [[maybe_unused]] pid_t peer) -> void override {
+        out = &flags[side == role::writer ? 0 : 1];
+        in = &flags[side == role::writer ? 1 : 0];
+    }
+
+    auto notify() -> void override {
+        out->store(1, std::memory_order_release);
+        if (futex(out, FUTEX_WAKE, 1) == -1) {
+            perror("futex wake");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    auto wait() -> void override {
+        while (in->exchange(0, std::memory_order_acquire) == 0)
+            if (futex(in, FUTEX_WAIT, 0) == -1 && errno != EAGAIN && errno != EINTR) {
+                perror("futex wait");
+                exit(EXIT_FAILURE);
+            }
+    }
+
+    auto teardown() -> void override {
+        munmap(flags, getpagesize());
+    }
+};
+
+// Signals are process state, so both signal notifiers block their signal
+// in setup() and restore the parent's mask and disposition in teardown().
+class signal_notifier : public notifier {
+  protected:
+    int signal_number = 0;
+    sigset_t blocked{};
+    sigset_t original_mask{};
+    pid_t target = 0;
+
+  public:
+    auto setup() -> void override {
+        sigemptyset(&blocked);
+        sigaddset(&blocked, signal_number);
+        if (sigprocmask(SIG_BLOCK, &blocked, &original_mask) == -1) {
+            perror("sigprocmask");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    auto attach([[maybe_unused]] role side, pid_t peer) -> void override {
+        target = peer;
+    }
+
+    auto teardown() -> void override {
+        sigprocmask(SIG_SETMASK, &original_mask, nullptr);
+    }
+};
+
+// A queued real-time signal taken synchronously with sigwaitinfo(), so no
+// handler runs on the wake-up path.
+class rtsig_notifier : public signal_notifier {
+  public:
+    rtsig_notifier() {
+        signal_number = SIGRTMIN;
+    }
+
+    auto notify() -> void override {
+        while (sigqueue(target, signal_number, sigval{}) == -1)
+            if (errno != EAGAIN) {
+                perror("sigqueue");
+                exit(EXIT_FAILURE);
+            }
+    }
+
+    auto wait() -> void override {
+        while (sigwaitinfo(&blocked, nullptr) == -1)
+            if (errno != EINTR) {
+                perror("sigwaitinfo");
+                exit(EXIT_FAILURE);
+            }
+    }
+};
+
+// The classic pattern: SIGUSR1 stays blocked except inside sigsuspend(),
+// where its handler runs and sets a flag.
+class sigsuspend_notifier : public signal_notifier {
+  private:
+    static inline volatile sig_atomic_t delivered = 0;
+    struct sigaction original_action {};
+    sigset_t waiting_mask{};
+
+    static auto on_signal([[maybe_unused]] int signal) -> void {
+        delivered = 1;
+    }
+
+  public:
+    sigsuspend_notifier() {
+        signal_number = SIGUSR1;
+    }
+
+    auto setup() -> void override {
+        struct sigaction action {};
+        action.sa_handler = on_signal;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(signal_number, &action, &original_action) == -1) {
+            perror("sigaction");
+            exit(EXIT_FAILURE);
+        }
+        signal_notifier::setup();
+        waiting_mask = original_mask;
+        sigdelset(&waiting_mask, signal_number);
+    }
+
+    auto notify() -> void override {
+        if (kill(target, signal_number) == -1) {
+            perror("kill");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    auto wait() -> void override {
+        while (!delivered)
+            sigsuspend(&waiting_mask);
+        delivered = 0;
+    }
+
+    auto teardown() -> void override {
+        signal_notifier::teardown();
+        sigaction(signal_number, &original_action, nullptr);
+    }
+};
+
+constexpr std::string_view notifier_names[] = {
+    "rtsig",
+    "eventfd",
+    "futex",
+    "pipe",
+    "sigsuspend",
+};
+
+static inline auto make_notifier(std::string_view name) -> std::unique_ptr<notifier> {
+    if (name == "rtsig")
+        return std::make_unique<rtsig_notifier>();
+    if (name == "eventfd")
+        return std::make_unique<eventfd_notifier>();
+    if (name == "futex")
+        return std::make_unique<futex_notifier>();
+    if (name == "pipe")
+        return std::make_unique<pipe_notifier>();
+    if (name == "sigsuspend")
+        return std::make_unique<sigsuspend_notifier>();
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,366 @@
+#pragma once
+
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include "frame.hpp"
+#include "notifier.hpp"
+#include "placement.hpp"
+#include "report.hpp"
+#include "transports.hpp"
+#include <charconv>
+#include <climits>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+enum class benchmark_mode {
+    throughput,
+    stream,
+    pingpong,
+    copy,
+    wakeup,
+};
+
+static inline auto mode_name(benchmark_mode mode) -> std::string_view {
+    switch (mode) {
+    case benchmark_mode::stream:
+        return "stream";
+    case benchmark_mode::pingpong:
+        return "pingpong";
+    case benchmark_mode::copy:
+        return "copy";
+    case benchmark_mode::wakeup:
+        return "wakeup";
+    default:
+        return "throughput";
+    }
+}
+
+enum class verify_mode {
+    none,
+    pattern, // compare every byte against the regenerated pattern
+    digest,  // check the CRC32C the writer sealed into the frame
+};
+
+static inline auto verify_name(verify_mode verify) -> std::string_view {
+    switch (verify) {
+    case verify_mode::pattern:
+        return "pattern";
+    case verify_mode::digest:
+        return "crc32c";
+    default:
+        return "none";
+    }
+}
+
+struct options {
+    std::vector<std::string> transports;
+    std::vector<size_t> frame_sizes{1 << 20};
+    size_t rounds = 1e4;
+    size_t warmup = 1e2;
+    output_format format = output_format::csv;
+    benchmark_mode mode = benchmark_mode::throughput;
+    std::vector<page_policy> pages{page_policy::base};
+    std::vector<size_t> queue_depths{8};
+    bool sqpoll = false;
+#ifdef FRAME_CHECK
+    verify_mode verify = verify_mode::pattern;
+#else
+    verify_mode verify = verify_mode::none;
+#endif
+    bool streaming_stores = false;
+    copy_policy copy{copy_engine::libc, default_copy_threshold()};
+    std::vector<placement> placements{placement::none};
+    std::vector<std::string> notifiers;
+    std::vector<unsigned> mq_priorities{0};
+    size_t send_buffer = 0;
+    size_t receive_buffer = 0;
+    bool tcp_nodelay = true;
+    unsigned busy_poll = 0;
+};
+
+[[noreturn]] static inline auto usage(const char *program) -> void {
+    std::string names, notifiers;
+    for (auto name : transport_names)
+        names += (names.empty() ? "" : "|") + std::string(name);
+    for (auto name : notifier_names)
+        notifiers += (notifiers.empty() ? "" : "|") + std::string(name);
+
+    std::cerr
+        << std::format("Usage: {} [options]\n"
+                       "  --transport=NAME[,NAME...]  {}|all (default: all)\n"
+                       "  --frame-size=SIZE[,SIZE...] bytes, K/M/G suffixes allowed (default: 1M)\n"
+                       "  --rounds=N                  measured frames per run (default: 10000)\n"
+                       "  --warmup=N                  unmeasured frames before timing starts (default: 100)\n"
+                       "  --format=csv|json           output format (default: csv)\n"
+                       "  --mode=MODE                 throughput, stream (one-way latency from a timestamp\n"
+                       "                              in the frame), pingpong (round trip per frame) or\n"
+                       "                              copy (memcpy against the nt engine, no transport) or\n"
+                       "                              wakeup (notification round trips, no transport)\n"
+                       "  --pages=4k|thp|2m[,...]     page size for transports that map their frames\n"
+                       "                              (eventfd_shm, posix_shm, memfd; default: 4k)\n"
+                       "  --queue-depth=N[,N...]      frames in flight for pipe_uring and fifo_uring,\n"
+                       "                              messages a POSIX mqueue holds, or frames per syscall\n"
+                       "                              for unix_iov and unix_seqpacket, or zero-copy send\n"
+                       "                              buffers for tcp_zerocopy (default: 8)\n"
+                       "  --mq-priority=N[,N...]      POSIX mqueue message priorities, taken in turn per frame,\n"
+                       "                              e.g. 0,0,0,7 sends every fourth frame urgent; mixed\n"
+                       "                              priorities tag frames with their sequence number and\n"
+                       "                              report latency per priority (default: 0)\n"
+                       "  --sndbuf=SIZE               SO_SNDBUF of the unix* and tcp* transports (default: kernel)\n"
+                       "  --rcvbuf=SIZE               SO_RCVBUF of the unix* and tcp* transports (default: kernel)\n"
+                       "  --tcp-nodelay=on|off        set TCP_NODELAY on tcp* transports (default: on)\n"
+                       "  --busy-poll=USEC            SO_BUSY_POLL on the tcp* receiver (default: 0, off)\n"
+                       "  --sqpoll=on|off             poll the io_uring submission queue from a kernel thread\n"
+                       "                              (default: off)\n"
+                       "  --verify=none|pattern|crc32c check every frame against the pattern, or against a\n"
+                       "                              CRC32C the writer stores in its last 4 bytes\n"
+                       "                              (default: pattern with FRAME_CHECK, none otherwise)\n"
+                       "  --nt-stores=on|off          generate frames with non-temporal stores (default: off)\n"
+                       "  --copy=memcpy|nt            how shm transports copy frames out (default: memcpy)\n"
+                       "  --copy-threshold=SIZE       smallest copy the nt engine handles (default: L2 / 2)\n"
+                       "  --placement=CLASS[,...]     pin writer and reader: none, same-core, smt, llc, socket\n"
+                       "                              or all; classes the topology lacks are skipped\n"
+                       "                              (default: none)\n"
+                       "  --notifier=NAME[,NAME...]   wake-up paths for --mode=wakeup: {}|all\n"
+                       "                              (default: all)",
+                       program, names, notifiers)
+        << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+static inline auto split(std::string_view text) -> std::vector<std::string_view> {
+    std::vector<std::string_view> result;
+    while (true) {
+        auto comma = text.find(',');
+        result.push_back(text.substr(0, comma));
+        if (comma == std::string_view::npos)
+            return result;
+        text.remove_prefix(comma + 1);
+    }
+}
+
+static inline auto parse_number(std::string_view text, size_t &value) -> bool {
+    size_t multiplier = 1;
+    if (!text.empty()) {
+        switch (text.back()) {
+        case 'K':
+        case 'k':
+            multiplier = 1 << 10;
+            break;
+        case 'M':
+        case 'm':
+            multiplier = 1 << 20;
+            break;
+        case 'G':
+        case 'g':
+            multiplier = 1 << 30;
+            break;
+        }
+        if (multiplier != 1)
+            text.remove_suffix(1);
+    }
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    value *= multiplier;
+    return ec == std::errc() && ptr == text.data() + text.size();
+}
+
+static inline auto parse_options(int argc, char *argv[]) -> options {
+    options opts;
+    for (auto name : transport_names)
+        opts.transports.emplace_back(name);
+    for (auto name : notifier_names)
+        opts.notifiers.emplace_back(name);
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        auto equal = arg.find('=');
+        if (!arg.starts_with("--") || equal == std::string_view::npos)
+            usage(argv[0]);
+        std::string_view key = arg.substr(2, equal - 2);
+        std::string_view value = arg.substr(equal + 1);
+
+        if (key == "transport") {
+            opts.transports.clear();
+            for (auto name : split(value)) {
+                if (name == "all") {
+                    for (auto known : transport_names)
+                        opts.transports.emplace_back(known);
+                } else if (make_transport(name) == nullptr)
+                    usage(argv[0]);
+                else
+                    opts.transports.emplace_back(name);
+            }
+        } else if (key == "frame-size") {
+            opts.frame_sizes.clear();
+            for (auto size : split(value)) {
+                size_t frame_size;
+                if (!parse_number(size, frame_size) || frame_size == 0)
+                    usage(argv[0]);
+                opts.frame_sizes.push_back(frame_size);
+            }
+        } else if (key == "rounds") {
+            if (!parse_number(value, opts.rounds) || opts.rounds == 0)
+                usage(argv[0]);
+        } else if (key == "warmup") {
+            if (!parse_number(value, opts.warmup))
+                usage(argv[0]);
+        } else if (key == "format") {
+            if (value == "csv")
+                opts.format = output_format::csv;
+            else if (value == "json")
+                opts.format = output_format::json;
+            else
+                usage(argv[0]);
+        } else if (key == "pages") {
+            opts.pages.clear();
+            for (auto pages : split(value)) {
+                if (pages == "4k")
+                    opts.pages.push_back(page_policy::base);
+                else if (pages == "thp")
+                    opts.pages.push_back(page_policy::transparent);
+                else if (pages == "2m")
+                    opts.pages.push_back(page_policy::huge);
+                else
+                    usage(argv[0]);
+            }
+        } else if (key == "queue-depth") {
+            opts.queue_depths.clear();
+            for (auto depth : split(value)) {
+                size_t queue_depth;
+                if (!parse_number(depth, queue_depth) || queue_depth == 0 || queue_depth > 4096)
+                    usage(argv[0]);
+                opts.queue_depths.push_back(queue_depth);
+            }
+        } else if (key == "mq-priority") {
+            opts.mq_priorities.clear();
+            for (auto text : split(value)) {
+                size_t priority;
+                if (!parse_number(text, priority) || priority >= static_cast<size_t>(sysconf(_SC_MQ_PRIO_MAX)))
+                    usage(argv[0]);
+                opts.mq_priorities.push_back(priority);
+            }
+            if (priority_classes(opts.mq_priorities).size() > max_priority_classes)
+                usage(argv[0]);
+        } else if (key == "sndbuf") {
+            if (!parse_number(value, opts.send_buffer) || opts.send_buffer == 0)
+                usage(argv[0]);
+        } else if (key == "rcvbuf") {
+            if (!parse_number(value, opts.receive_buffer) || opts.receive_buffer == 0)
+                usage(argv[0]);
+        } else if (key == "tcp-nodelay") {
+            if (value == "on")
+                opts.tcp_nodelay = true;
+            else if (value == "off")
+                opts.tcp_nodelay = false;
+            else
+                usage(argv[0]);
+        } else if (key == "busy-poll") {
+            size_t microseconds;
+            if (!parse_number(value, microseconds) || microseconds > INT_MAX)
+                usage(argv[0]);
+            opts.busy_poll = microseconds;
+        } else if (key == "sqpoll") {
+            if (value == "on")
+                opts.sqpoll = true;
+            else if (value == "off")
+                opts.sqpoll = false;
+            else
+                usage(argv[0]);
+        } else if (key == "verify") {
+            if (value == "none")
+                opts.verify = verify_mode::none;
+            else if (value == "pattern")
+                opts.verify = verify_mode::pattern;
+            else if (value == "crc32c")
+                opts.verify = verify_mode::digest;
+            else
+                usage(argv[0]);
+        } else if (key == "nt-stores") {
+            if (value == "on")
+                opts.streaming_stores = true;
+            else if (value == "off")
+                opts.streaming_stores = false;
+            else
+                usage(argv[0]);
+        } else if (key == "copy") {
+            if (value == "memcpy")
+                opts.copy.engine = copy_engine::libc;
+            else if (value == "nt")
+                opts.copy.engine = copy_engine::streaming;
+            else
+                usage(argv[0]);
+        } else if (key == "copy-threshold") {
+            if (!parse_number(value, opts.copy.threshold))
+                usage(argv[0]);
+        } else if (key == "placement") {
+            opts.placements.clear();
+            for (auto name : split(value)) {
+                bool known = false;
+                for (placement where : placement_classes)
+                    if (name == "all" || name == placement_name(where)) {
+                        opts.placements.push_back(where);
+                        known = true;
+                    }
+                if (!known)
+                    usage(argv[0]);
+            }
+        } else if (key == "notifier") {
+            opts.notifiers.clear();
+            for (auto name : split(value)) {
+                if (name == "all") {
+                    for (auto known : notifier_names)
+                        opts.notifiers.emplace_back(known);
+                } else if (make_notifier(name) == nullptr)
+                    usage(argv[0]);
+                else
+                    opts.notifiers.emplace_back(name);
+            }
+        } else if (key == "mode") {
+            if (value == "throughput")
+                opts.mode = benchmark_mode::throughput;
+            else if (value == "stream")
+                opts.mode = benchmark_mode::stream;
+            else if (value == "pingpong")
+                opts.mode = benchmark_mode::pingpong;
+            else if (value == "copy")
+                opts.mode = benchmark_mode::copy;
+            else if (value == "wakeup")
+                opts.mode = benchmark_mode::wakeup;
+            else
+                usage(argv[0]);
+        } else
+            usage(argv[0]);
+    }
+
+    if (opts.mode == benchmark_mode::stream)
+        for (size_t frame_size : opts.frame_sizes)
+            if (frame_size < sizeof(uint64_t)) {
+                std::cerr << "Stream mode needs frames of at least 8 bytes for the timestamp" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+    // Frames that may overtake each other carry their sequence number
+    // after any timestamp.
+    const size_t header = (opts.mode == benchmark_mode::stream ? sizeof(uint64_t) : 0) +
+                          (priority_classes(opts.mq_priorities).size() > 1 ? sizeof(uint64_t) : 0);
+    for (size_t frame_size : opts.frame_sizes)
+        if (frame_size < header) {
+            std::cerr << "Mixed mqueue priorities need room for the sequence number after any timestamp" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    if (opts.verify == verify_mode::digest)
+        for (size_t frame_size : opts.frame_sizes)
+            if (frame_size < digest_size + header) {
+                std::cerr << "CRC32C verification needs room for the digest after any timestamp" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+
+    return opts;
+}
+
+#endif
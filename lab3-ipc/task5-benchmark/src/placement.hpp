@@ -0,0 +1,162 @@
+#pragma once
+
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <optional>
+#include <sched.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class placement {
+    none,         // leave both sides to the scheduler
+    same_core,    // writer and reader share one logical CPU
+    smt_sibling,  // two hardware threads of one physical core
+    same_llc,     // different physical cores behind one last-level cache
+    cross_socket, // different packages
+};
+
+constexpr placement placement_classes[] = {
+    placement::none,
+    placement::same_core,
+    placement::smt_sibling,
+    placement::same_llc,
+    placement::cross_socket,
+};
+
+static inline auto placement_name(placement where) -> std::string_view {
+    switch (where) {
+    case placement::same_core:
+        return "same-core";
+    case placement::smt_sibling:
+        return "smt";
+    case placement::same_llc:
+        return "llc";
+    case placement::cross_socket:
+        return "socket";
+    default:
+        return "none";
+    }
+}
+
+struct cpu_info {
+    int cpu;
+    int package;
+    int core;
+    std::string llc; // shared_cpu_list of the highest cache level
+};
+
+static inline auto read_sysfs(const std::string &path) -> std::optional<std::string> {
+    std::ifstream file(path);
+    std::string value;
+    if (!file || !std::getline(file, value))
+        return std::nullopt;
+    return value;
+}
+
+// The CPUs this process may run on, described from /sys/devices/system/cpu.
+static inline auto discover_topology() -> std::vector<cpu_info> {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1) {
+        perror("sched_getaffinity");
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<cpu_info> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed))
+            continue;
+        std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        auto package = read_sysfs(base + "/topology/physical_package_id");
+        auto core = read_sysfs(base + "/topology/core_id");
+
+        std::string llc;
+        int llc_level = 0;
+        for (int index = 0;; ++index) {
+            std::string cache = base + "/cache/index" + std::to_string(index);
+            auto level = read_sysfs(cache + "/level");
+            if (!level)
+                break;
+            if (read_sysfs(cache + "/type") == "Instruction" || std::stoi(*level) <= llc_level)
+                continue;
+            llc_level = std::stoi(*level);
+            llc = read_sysfs(cache + "/shared_cpu_list").value_or("");
+        }
+
+        cpus.push_back({cpu, package ? std::stoi(*package) : 0, core ? std::stoi(*core) : cpu, llc});
+    }
+    return cpus;
+}
+
+struct cpu_pair {
+    int writer;
+    int reader;
+};
+
+// The first pair of CPUs in the given class, if this machine has one.
+static inline auto pick_cpus(const std::vector<cpu_info> &cpus, placement where) -> std::optional<cpu_pair> {
+    for (const auto &a : cpus)
+        for (const auto &b : cpus) {
+            bool same_cpu = a.cpu == b.cpu;
+            bool same_core = a.package == b.package && a.core == b.core;
+            bool matches = false;
+            switch (where) {
+            case placement::same_core:
+                matches = same_cpu;
+                break;
+            case placement::smt_sibling:
+                matches = !same_cpu && same_core;
+                break;
+            case placement::same_llc:
+                matches = !same_core && a.package == b.package && a.llc == b.llc;
+                break;
+            case placement::cross_socket:
+                matches = a.package != b.package;
+                break;
+            default:
+                break;
+            }
+            if (matches)
+                return cpu_pair{a.cpu, b.cpu};
+        }
+    return std::nullopt;
+}
+
+// Where a run's two processes go: the class and, unless it is "none", the
+// CPU each side is pinned to.
+struct run_placement {
+    placement where;
+    std::optional<cpu_pair> cpus;
+};
+
+static inline auto current_affinity() -> cpu_set_t {
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == -1) {
+        perror("sched_getaffinity");
+        exit(EXIT_FAILURE);
+    }
+    return set;
+}
+
+static inline auto restore_affinity(const cpu_set_t &set) -> void {
+    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
+        perror("sched_setaffinity");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static inline auto pin_to(int cpu) -> void {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
+        perror("sched_setaffinity");
+        exit(EXIT_FAILURE);
+    }
+}
+
+#endif
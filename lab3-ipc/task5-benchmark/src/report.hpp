@@ -0,0 +1,117 @@
+#pragma once
+
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class output_format {
+    csv,
+    json,
+};
+
+// One result row. Every run of the driver emits records with the same
+// fields in the same order, whichever transport produced them.
+class record {
+  private:
+    struct field {
+        std::string key;
+        std::string value;
+        bool quoted;
+    };
+    std::vector<field> fields;
+
+  public:
+    auto add(std::string_view key, std::string_view value) -> record & {
+        fields.push_back({std::string(key), std::string(value), true});
+        return *this;
+    }
+    auto add(std::string_view key, const char *value) -> record & {
+        return add(key, std::string_view(value));
+    }
+    auto add(std::string_view key, uint64_t value) -> record & {
+        fields.push_back({std::string(key), std::format("{}", value), false});
+        return *this;
+    }
+    auto add(std::string_view key, double value) -> record & {
+        fields.push_back({std::string(key), std::format("{:.6f}", value), false});
+        return *this;
+    }
+    // A missing value leaves the CSV cell empty and becomes null in JSON.
+    auto add(std::string_view key, std::optional<double> value) -> record & {
+        if (!value) {
+            fields.push_back({std::string(key), "", false});
+            return *this;
+        }
+        return add(key, *value);
+    }
+    auto add(std::string_view key, bool value) -> record & {
+        fields.push_back({std::string(key), value ? "true" : "false", false});
+        return *this;
+    }
+
+    auto header() const -> std::string {
+        std::string result;
+        for (const auto &f : fields)
+            result += (result.empty() ? "" : ",") + f.key;
+        return result;
+    }
+
+    auto csv() const -> std::string {
+        std::string result;
+        for (size_t i = 0; i < fields.size(); ++i)
+            result += (i ? "," : "") + fields[i].value;
+        return result;
+    }
+
+    auto json() const -> std::string {
+        std::string result = "{";
+        for (size_t i = 0; i < fields.size(); ++i) {
+            const auto &f = fields[i];
+            result += std::format("{}\"{}\": ", i ? ", " : "", f.key);
+            if (f.quoted)
+                result += std::format("\"{}\"", f.value);
+            else
+                result += f.value.empty() ? "null" : f.value;
+        }
+        return result + "}";
+    }
+};
+
+class reporter {
+  private:
+    output_format format;
+    std::string last_header;
+    size_t count = 0;
+
+  public:
+    explicit reporter(output_format format) : format(format) {
+        if (format == output_format::json)
+            std::cout << "[" << std::flush;
+    }
+
+    ~reporter() {
+        if (format == output_format::json)
+            std::cout << (count ? "\n]" : "]") << std::endl;
+    }
+
+    auto add(const record &result) -> void {
+        if (format == output_format::csv) {
+            std::string header = result.header();
+            if (header != last_header)
+                std::cout << header << std::endl;
+            last_header = header;
+            std::cout << result.csv() << std::endl;
+        } else
+            std::cout << (count ? ",\n  " : "\n  ") << result.json() << std::flush;
+        ++count;
+    }
+};
+
+#endif
@@ -0,0 +1,143 @@
+#pragma once
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include "copy.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+enum class role {
+    writer,
+    reader,
+};
+
+enum class page_policy {
+    base,        // regular 4 KiB pages
+    transparent, // ask for transparent huge pages with madvise
+    huge,        // hugetlb 2 MiB pages, needs pages reserved in nr_hugepages
+};
+
+static inline auto page_policy_name(page_policy pages) -> std::string_view {
+    switch (pages) {
+    case page_policy::transparent:
+        return "thp";
+    case page_policy::huge:
+        return "2m";
+    default:
+        return "4k";
+    }
+}
+
+struct run_config {
+    size_t frame_size;
+    size_t frames;             // warmup and measured frames together
+    page_policy pages = page_policy::base;
+    size_t queue_depth = 8;    // frames in flight for io_uring transports and POSIX mqueues,
+                               // frames per syscall for batching socket transports
+    bool sqpoll = false;       // let a kernel thread poll the io_uring submission queue
+    copy_policy copy{};        // how transports that copy frames out do it
+    std::vector<unsigned> mq_priorities{0}; // POSIX mqueue priorities, frame i is sent at entry i % size
+    size_t send_buffer = 0;    // SO_SNDBUF for socket transports, 0 keeps the default
+    size_t receive_buffer = 0; // SO_RCVBUF for socket transports, 0 keeps the default
+    bool round_trip = false;   // every frame waits for its echo, so none may be held back
+    bool tcp_nodelay = true;   // disable Nagle on TCP transports
+    unsigned busy_poll = 0;    // SO_BUSY_POLL microseconds on TCP receivers, 0 leaves it off
+};
+
+// At most this many distinct priorities get their own latency histogram.
+constexpr size_t max_priority_classes = 8;
+
+// The distinct priorities of a schedule, lowest first.
+static inline auto priority_classes(std::vector<unsigned> schedule) -> std::vector<unsigned> {
+    std::sort(schedule.begin(), schedule.end());
+    schedule.erase(std::unique(schedule.begin(), schedule.end()), schedule.end());
+    return schedule;
+}
+
+static inline auto scheduled_priority(const run_config &config, uint64_t sequence) -> unsigned {
+    return config.mq_priorities[sequence % config.mq_priorities.size()];
+}
+
+// A one-way frame channel between a forked writer and reader.
+//
+// setup() runs in the parent before fork() and creates everything both sides
+// inherit, attach() and detach() run in each process, teardown() runs in the
+// parent after the reader has exited. Frames are produced in place: the
+// writer fills the buffer returned by begin_send() and hands it over with
+// end_send(), the reader gets the next frame from begin_receive() and gives
+// the buffer back with end_receive().
+class transport {
+  public:
+    virtual ~transport() = default;
+
+    virtual auto max_frame_size() const -> size_t { return SIZE_MAX; }
+    // Transports that place frames in a mapping they create honour
+    // run_config::pages and report what they actually got after setup().
+    virtual auto maps_frames() const -> bool { return false; }
+    virtual auto pages() const -> std::string_view { return "-"; }
+    // Transports that keep several frames in flight honour
+    // run_config::queue_depth.
+    virtual auto queues_frames() const -> bool { return false; }
+    // Transports that deliver by priority send frame i at
+    // scheduled_priority(config, i) and report the priority the frame last
+    // returned by begin_receive() carried. With mixed priorities a frame
+    // may overtake the ones sent before it.
+    virtual auto prioritises_frames() const -> bool { return false; }
+    virtual auto received_priority() const -> unsigned { return 0; }
+    // Transport-specific knobs that shaped the run, e.g. "qd=8".
+    virtual auto settings() const -> std::string { return "-"; }
+    // Syscalls spent moving frames so far, for transports that count them.
+    virtual auto syscalls() const -> std::optional<uint64_t> { return std::nullopt; }
+    virtual auto setup(const run_config &config) -> void = 0;
+    virtual auto attach(role side) -> void = 0;
+    virtual auto begin_send() -> std::byte * = 0;
+    virtual auto end_send() -> void = 0;
+    virtual auto begin_receive() -> const std::byte * = 0;
+    virtual auto end_receive() -> void {}
+    virtual auto detach(role side) -> void = 0;
+    virtual auto teardown() -> void {}
+};
+
+// Both return the number of syscalls the transfer took.
+static inline auto write_all(int fd, const std::byte *data, size_t size) -> uint64_t {
+    const std::byte *end = data + size;
+    uint64_t calls = 0;
+    for (; data != end; ++calls) {
+        auto result = write(fd, data, end - data);
+        if (result == -1) {
+            perror("write");
+            exit(EXIT_FAILURE);
+        }
+        data += result;
+    }
+    return calls;
+}
+
+static inline auto read_all(int fd, std::byte *data, size_t size) -> uint64_t {
+    std::byte *end = data + size;
+    uint64_t calls = 0;
+    for (; data != end; ++calls) {
+        auto result = read(fd, data, end - data);
+        if (result == -1) {
+            perror("read");
+            exit(EXIT_FAILURE);
+        }
+        if (result == 0) {
+            std::fputs("read: unexpected end of stream\n", stderr);
+            exit(EXIT_FAILURE);
+        }
+        data += result;
+    }
+    return calls;
+}
+
+#endif
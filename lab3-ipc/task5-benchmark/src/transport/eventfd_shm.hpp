@@ -0,0 +1,117 @@
+#pragma once
+
+#ifndef TRANSPORT_EVENTFD_SHM_H
+#define TRANSPORT_EVENTFD_SHM_H
+
+#include "../frame.hpp"
+#include "../transport.hpp"
+#include "mapping.hpp"
+#include <cstring>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// One frame in a shared mapping, with an eventfd per direction telling the
+// other side that the frame is full or free again. The base class maps
+// anonymous memory; subclasses only change where the mapping comes from.
+class eventfd_shm_transport : public transport {
+  private:
+    int full_fd = -1;
+    int free_fd = -1;
+
+    static auto wait_event(int fd) -> void {
+        eventfd_t value;
+        if (eventfd_read(fd, &value) == -1) {
+            perror("eventfd_read");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    static auto post_event(int fd) -> void {
+        if (eventfd_write(fd, 1) == -1) {
+            perror("eventfd_write");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+  protected:
+    size_t frame_size = 0;
+    size_t mapped_length = 0;
+    page_policy used_pages = page_policy::base;
+    std::byte *shared_frame = nullptr;
+    frame_ptr local_frame;
+    copy_policy copy;
+
+    virtual auto map_frame(const run_config &config) -> void {
+        if (config.pages == page_policy::huge) {
+            mapped_length = mapping_length(frame_size, page_policy::huge);
+            void *memory = mmap(nullptr, mapped_length, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (memory != MAP_FAILED) {
+                shared_frame = static_cast<std::byte *>(memory);
+                used_pages = page_policy::huge;
+                return;
+            }
+            warn_huge_fallback("mmap MAP_HUGETLB");
+        }
+        mapped_length = mapping_length(frame_size, config.pages);
+        shared_frame = map_shared(-1, mapped_length, config.pages, used_pages);
+    }
+
+  public:
+    auto settings() const -> std::string override {
+        return copy_settings(copy);
+    }
+
+    auto maps_frames() const -> bool override {
+        return true;
+    }
+
+    auto pages() const -> std::string_view override {
+        return page_policy_name(used_pages);
+    }
+
+    auto setup(const run_config &config) -> void override {
+        frame_size = config.frame_size;
+        local_frame = allocate_frame(frame_size);
+        copy = config.copy;
+        map_frame(config);
+
+        full_fd = eventfd(0, 0);
+        free_fd = eventfd(1, 0);
+        if (full_fd == -1 || free_fd == -1) {
+            perror("eventfd");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    auto attach(role) -> void override {
+    }
+
+    auto begin_send() -> std::byte * override {
+        wait_event(free_fd);
+        return shared_frame;
+    }
+
+    auto end_send() -> void override {
+        post_event(full_fd);
+    }
+
+    auto begin_receive() -> const std::byte * override {
+        wait_event(full_fd);
+        copy_frame(local_frame.get(), shared_frame, frame_size, copy);
+        post_event(free_fd);
+        return local_frame.get();
+    }
+
+    auto detach(role) -> void override {
+        close(full_fd);
+        close(free_fd);
+    }
+
+    auto teardown() -> void override {
+        munmap(shared_frame, mapped_length);
+    }
+};
+
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+#ifndef TRANSPORT_FIFO_H
+#define TRANSPORT_FIFO_H
+
+#include "stream.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <format>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class fifo_transport : public stream_transport {
+  private:
+    static inline size_t instances = 0;
+    std::string fifo_path;
+
+  public:
+    auto setup(const run_config &config) -> void override {
+        stream_transport::setup(config);
+
+        fifo_path = std::format("/tmp/ipc_benchmark_fifo_{}_{}", getpid(), instances++);
+        if (mkfifo(fifo_path.c_str(), 0600) == -1 && errno != EEXIST) {
+            perror("mkfifo");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    auto attach(role side) -> void override {
+        if (side == role::writer) {
+            write_fd = open(fifo_path.c_str(), O_WRONLY);
+            if (write_fd == -1) {
+                perror("open fifo for writing");
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            read_fd = open(fifo_path.c_str(), O_RDONLY);
+            if (read_fd == -1) {
+                perror("open fifo for reading");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    auto teardown() -> void override {
+        unlink(fifo_path.c_str());
+    }
+};
+
+#endif
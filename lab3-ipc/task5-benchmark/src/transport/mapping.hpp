@@ -0,0 +1,100 @@
+#pragma once
+
+#ifndef TRANSPORT_MAPPING_H
+#define TRANSPORT_MAPPING_H
+
+#include "../transport.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+
+constexpr size_t huge_page_size = 2 << 20;
+
+static inline auto round_up(size_t size, size_t alignment) -> size_t {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+static inline auto mapping_length(size_t size, page_policy pages) -> size_t {
+    return round_up(size, pages == page_policy::base ? 4096 : huge_page_size);
+}
+
+// Shared mappings, anonymous ones included, are shmem, and shmem only gets
+// transparent huge pages when shmem_enabled allows it; the bracketed word is
+// the active setting.
+static inline auto shmem_thp_allowed() -> bool {
+    std::ifstream file("/sys/kernel/mm/transparent_hugepage/shmem_enabled");
+    std::string setting;
+    while (file >> setting)
+        if (setting.starts_with('['))
+            return setting == "[always]" || setting == "[within_size]" || setting == "[advise]" || setting == "[force]";
+    return false;
+}
+
+// Kilobytes of the mapping at `address` that are mapped with PMDs, i.e.
+// really sit on huge pages, from the ShmemPmdMapped line in /proc/self/smaps.
+static inline auto shmem_pmd_mapped_kb(const void *address) -> size_t {
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool inside = false;
+    while (std::getline(smaps, line)) {
+        // Field lines start with "Name:", mapping headers with "start-end".
+        std::string first = line.substr(0, line.find(' '));
+        if (!first.ends_with(':')) {
+            inside = std::stoull(first, nullptr, 16) == reinterpret_cast<uintptr_t>(address);
+            continue;
+        }
+        if (inside && line.starts_with("ShmemPmdMapped:")) {
+            size_t kilobytes = 0;
+            std::istringstream(line.substr(line.find(':') + 1)) >> kilobytes;
+            return kilobytes;
+        }
+    }
+    return 0;
+}
+
+// Maps fd (or anonymous memory for fd == -1) shared and, for the
+// transparent policy, asks the kernel to back it with huge pages. A
+// successful madvise() proves nothing for shmem, so the mapping is touched
+// once per huge page and only reported as THP if huge pages actually back
+// it; otherwise the run goes on with base pages instead of failing.
+static inline auto map_shared(int fd, size_t length, page_policy requested, page_policy &used) -> std::byte * {
+    int flags = MAP_SHARED | (fd == -1 ? MAP_ANONYMOUS : 0);
+    void *memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (memory == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+
+    auto *data = static_cast<std::byte *>(memory);
+    used = page_policy::base;
+    if (requested == page_policy::base)
+        return data;
+    if (!shmem_thp_allowed()) {
+        std::cerr << "THP is off for shmem (see /sys/kernel/mm/transparent_hugepage/shmem_enabled), using 4 KiB pages"
+                  << std::endl;
+        return data;
+    }
+    if (madvise(memory, length, MADV_HUGEPAGE) == -1) {
+        perror("madvise MADV_HUGEPAGE, using 4 KiB pages");
+        return data;
+    }
+    for (size_t offset = 0; offset < length; offset += huge_page_size)
+        data[offset] = std::byte{0};
+    if (shmem_pmd_mapped_kb(memory) == 0)
+        std::cerr << "No transparent huge pages backed the mapping, using 4 KiB pages" << std::endl;
+    else
+        used = page_policy::transparent;
+    return data;
+}
+
+static inline auto warn_huge_fallback(std::string_view what,
+                                      std::string_view reason = "no hugetlb pages available (see /proc/sys/vm/nr_hugepages)") -> void {
+    std::cerr << std::format("{}: {}, falling back to THP", what, reason) << std::endl;
+}
+
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef TRANSPORT_MEMFD_H
+#define TRANSPORT_MEMFD_H
+
+#include "eventfd_shm.hpp"
+#include "mapping.hpp"
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Frame in a memfd. With the huge policy the memfd is created on hugetlbfs
+// (MFD_HUGETLB), which only works when 2 MiB pages are reserved.
+class memfd_transport : public eventfd_shm_transport {
+  private:
+    auto create(unsigned int flags, size_t length) -> int {
+        int fd = memfd_create("ipc_benchmark", flags);
+        if (fd == -1)
+            return -1;
+        if (ftruncate(fd, length) == -1) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+  protected:
+    auto map_frame(const run_config &config) -> void override {
+        if (config.pages == page_policy::huge) {
+            mapped_length = mapping_length(frame_size, page_policy::huge);
+            int fd = create(MFD_HUGETLB, mapped_length);
+            if (fd != -1) {
+                void *memory = mmap(nullptr, mapped_length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                close(fd);
+                if (memory != MAP_FAILED) {
+                    shared_frame = static_cast<std::byte *>(memory);
+                    used_pages = page_policy::huge;
+                    return;
+                }
+            }
+            warn_huge_fallback("memfd_create MFD_HUGETLB");
+        }
+
+        page_policy pages = config.pages == page_policy::huge ? page_policy::transparent : config.pages;
+        mapped_length = mapping_length(frame_size, pages);
+        int fd = create(0, mapped_length);
+        if (fd == -1) {
+            perror("memfd_create");
+            exit(EXIT_FAILURE);
+        }
+        shared_frame = map_shared(fd, mapped_length, pages, used_pages);
+        close(fd);
+    }
+};
+
+#endif
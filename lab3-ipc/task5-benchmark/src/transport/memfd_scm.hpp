@@ -0,0 +1,209 @@
+#pragma once
+
+#ifndef TRANSPORT_MEMFD_SCM_H
+#define TRANSPORT_MEMFD_SCM_H
+
+#include "../transport.hpp"
+#include "mapping.hpp"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+constexpr size_t memfd_scm_slots = 4;
+
+// Frames travel as memfd descriptors over a SOCK_SEQPACKET Unix socket
+// (SCM_RIGHTS) and the reader maps each one read-only. The reader answers
+// every frame with the slot index once it has unmapped it, which bounds the
+// number of memfds in flight to memfd_scm_slots.
+//
+// Without pooling every frame gets a fresh memfd that is sealed with
+// F_SEAL_WRITE before it is sent, so the reader can rely on it never
+// changing; the cost is a memfd_create, ftruncate and mmap per frame.
+// Seals cannot be removed again, so the pooled variant instead keeps one
+// long-lived memfd per slot and seals it with F_SEAL_FUTURE_WRITE: nobody
+// can create a new writable mapping, but the writer keeps the one it made
+// before sealing and reuses it for every frame in that slot.
+class memfd_scm_transport : public transport {
+  private:
+    struct slot {
+        int fd = -1;
+        std::byte *data = nullptr;
+    };
+
+    bool pooled;
+    int writer_fd = -1;
+    int reader_fd = -1;
+    size_t frame_size = 0;
+    size_t mapped_length = 0;
+    std::vector<slot> slots;
+    std::vector<uint32_t> free_slots;
+    uint32_t current = 0;
+    const std::byte *received = nullptr;
+
+    static auto send_slot(int sock, uint32_t index, int fd) -> void {
+        iovec iov{&index, sizeof(index)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))]{};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        if (fd != -1) {
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+            std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+        }
+        if (sendmsg(sock, &msg, MSG_NOSIGNAL) == -1) {
+            perror("sendmsg");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    static auto receive_slot(int sock, int *fd) -> uint32_t {
+        uint32_t index;
+        iovec iov{&index, sizeof(index)};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))]{};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != sizeof(index)) {
+            perror("recvmsg");
+            exit(EXIT_FAILURE);
+        }
+        if (fd != nullptr) {
+            cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+            if (cmsg == nullptr || cmsg->cmsg_type != SCM_RIGHTS) {
+                std::fputs("recvmsg: frame without a descriptor\n", stderr);
+                exit(EXIT_FAILURE);
+            }
+            std::memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+        return index;
+    }
+
+    auto create_memfd() -> int {
+        int fd = memfd_create("ipc_benchmark_frame", MFD_ALLOW_SEALING | MFD_CLOEXEC);
+        if (fd == -1) {
+            perror("memfd_create");
+            exit(EXIT_FAILURE);
+        }
+        if (ftruncate(fd, mapped_length) == -1) {
+            perror("ftruncate");
+            exit(EXIT_FAILURE);
+        }
+        return fd;
+    }
+
+    static auto map(int fd, size_t length, int protection) -> std::byte * {
+        void *memory = mmap(nullptr, length, protection, MAP_SHARED, fd, 0);
+        if (memory == MAP_FAILED) {
+            perror("mmap");
+            exit(EXIT_FAILURE);
+        }
+        return static_cast<std::byte *>(memory);
+    }
+
+    static auto add_seals(int fd, int seals) -> void {
+        if (fcntl(fd, F_ADD_SEALS, seals) == -1) {
+            perror("fcntl F_ADD_SEALS");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+  public:
+    explicit memfd_scm_transport(bool pooled) : pooled(pooled) {}
+
+    auto setup(const run_config &config) -> void override {
+        frame_size = config.frame_size;
+        mapped_length = mapping_length(frame_size, page_policy::base);
+
+        int socket_fd[2];
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, socket_fd) == -1) {
+            perror("socketpair");
+            exit(EXIT_FAILURE);
+        }
+        writer_fd = socket_fd[0];
+        reader_fd = socket_fd[1];
+    }
+
+    auto attach(role side) -> void override {
+        close(side == role::writer ? reader_fd : writer_fd);
+        if (side == role::reader)
+            return;
+
+        slots.resize(memfd_scm_slots);
+        for (uint32_t i = 0; i < memfd_scm_slots; ++i) {
+            free_slots.push_back(i);
+            if (pooled) {
+                slots[i].fd = create_memfd();
+                slots[i].data = map(slots[i].fd, mapped_length, PROT_READ | PROT_WRITE);
+                add_seals(slots[i].fd, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_FUTURE_WRITE | F_SEAL_SEAL);
+            }
+        }
+    }
+
+    auto begin_send() -> std::byte * override {
+        if (free_slots.empty())
+            free_slots.push_back(receive_slot(writer_fd, nullptr));
+        current = free_slots.back();
+        free_slots.pop_back();
+
+        if (!pooled) {
+            slots[current].fd = create_memfd();
+            slots[current].data = map(slots[current].fd, mapped_length, PROT_READ | PROT_WRITE);
+        }
+        return slots[current].data;
+    }
+
+    auto end_send() -> void override {
+        slot &frame = slots[current];
+        if (!pooled) {
+            munmap(frame.data, mapped_length);
+            add_seals(frame.fd, F_SEAL_WRITE | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+        }
+        send_slot(writer_fd, current, frame.fd);
+        if (!pooled) {
+            close(frame.fd);
+            frame = slot{};
+        }
+    }
+
+    auto begin_receive() -> const std::byte * override {
+        int fd;
+        current = receive_slot(reader_fd, &fd);
+        if (!pooled && !(fcntl(fd, F_GET_SEALS) & F_SEAL_WRITE)) {
+            std::fputs("memfd_scm: received a frame that is not write-sealed\n", stderr);
+            exit(EXIT_FAILURE);
+        }
+        received = map(fd, mapped_length, PROT_READ);
+        close(fd);
+        return received;
+    }
+
+    auto end_receive() -> void override {
+        munmap(const_cast<std::byte *>(received), mapped_length);
+        send_slot(reader_fd, current, -1);
+    }
+
+    auto detach(role side) -> void override {
+        if (side == role::writer) {
+            while (free_slots.size() != memfd_scm_slots)
+                free_slots.push_back(receive_slot(writer_fd, nullptr));
+            for (auto &frame : slots)
+                if (frame.fd != -1) {
+                    munmap(frame.data, mapped_length);
+                    close(frame.fd);
+                }
+        }
+        close(side == role::writer ? writer_fd : reader_fd);
+    }
+};
+
+#endif
@@ -0,0 +1,281 @@
+#pragma once
+
+#ifndef TRANSPORT_MQUEUE_H
+#define TRANSPORT_MQUEUE_H
+
+#include "../frame.hpp"
+#include "../transport.hpp"
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <mqueue.h>
+#include <new>
+#include <semaphore.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+constexpr size_t default_mq_msgsize_max = 8192;
+constexpr size_t default_mq_msg_max = 10;
+
+static inline auto read_mqueue_limit(const char *name, size_t fallback) -> size_t {
+    std::ifstream file(std::format("/proc/sys/fs/mqueue/{}", name));
+    size_t value = fallback;
+    if (!(file >> value))
+        std::cerr << std::format("Failed to read /proc/sys/fs/mqueue/{}, assuming {}", name, fallback) << std::endl;
+    return value;
+}
+
+// How the reader waits when the queue is empty.
+enum class mqueue_wait {
+    blocking, // plain blocking mq_receive()
+    epoll,    // non-blocking descriptor, epoll_wait() on it when empty
+    notify,   // non-blocking descriptor, mq_notify() wakes a helper thread
+};
+
+// What mq_notify() hands to its callback. glibc delivers SIGEV_THREAD
+// notifications through one netlink socket that a fork()ed child inherits,
+// so the callback may run in the other process; keeping this in a shared
+// page mapped before fork() makes it wake the right reader either way.
+struct mqueue_notification {
+    sem_t posted;
+    std::atomic<bool> armed; // a notification is registered
+};
+
+// A POSIX message queue with one frame per message, sent at the priorities
+// given by --mq-priority in turn. The queue holds queue_depth messages,
+// capped by /proc/sys/fs/mqueue/msg_max. It is unlinked as soon as both
+// descriptors are open, so nothing is left behind in /dev/mqueue.
+class mqueue_transport : public transport {
+  private:
+    mqueue_wait waiting;
+    mqd_t send_queue = -1;
+    mqd_t receive_queue = -1;
+    size_t frame_size = 0;
+    size_t depth = 0;
+    std::vector<unsigned> priorities;
+    uint64_t sent = 0;
+    unsigned last_priority = 0;
+    frame_ptr buffer;
+    uint64_t syscall_count = 0;
+
+    int epoll_fd = -1;
+    mqueue_notification *notification = nullptr;
+
+    static auto on_notify(sigval value) -> void {
+        auto *state = static_cast<mqueue_notification *>(value.sival_ptr);
+        state->armed.store(false, std::memory_order_release);
+        sem_post(&state->posted);
+    }
+
+    auto try_receive() -> bool {
+        ++syscall_count;
+        if (mq_receive(receive_queue, reinterpret_cast<char *>(buffer.get()), frame_size, &last_priority) == -1) {
+            if (errno == EAGAIN)
+                return false;
+            perror("mq_receive");
+            exit(EXIT_FAILURE);
+        }
+        return true;
+    }
+
+    auto send(unsigned priority) -> void {
+        ++syscall_count;
+        while (mq_send(send_queue, reinterpret_cast<const char *>(buffer.get()), frame_size, priority) == -1)
+            if (errno != EINTR) {
+                perror("mq_send");
+                exit(EXIT_FAILURE);
+            }
+    }
+
+    // Fills the queue with the lowest priority but one message of the
+    // highest, queued last, and expects that one back first. Runs in setup(),
+    // so the driver's syscall counts do not see it.
+    auto check_priority_order() -> void {
+        auto classes = priority_classes(priorities);
+        if (depth < 2) {
+            std::cerr << "POSIX mqueue depth 1 holds no two priorities at once, not checking their order" << std::endl;
+            return;
+        }
+        for (size_t i = 0; i + 1 < depth; ++i)
+            send(classes.front());
+        send(classes.back());
+        for (size_t i = 0; i < depth; ++i) {
+            if (!try_receive()) {
+                std::cerr << "mq_receive: priority check message missing" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            unsigned expected = i == 0 ? classes.back() : classes.front();
+            if (last_priority != expected) {
+                std::cerr << std::format("mq_receive: message {} of the priority check has priority {} instead of {}",
+                                         i, last_priority, expected)
+                          << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+        syscall_count = 0;
+    }
+
+    // mq_notify() fires once, and only when a message lands in an empty
+    // queue, so the reader registers and then looks again before sleeping.
+    // Returns whether that second look already got the frame.
+    auto wait_notified() -> bool {
+        if (!notification->armed.load(std::memory_order_acquire)) {
+            sigevent event{};
+            event.sigev_notify = SIGEV_THREAD;
+            event.sigev_notify_function = on_notify;
+            event.sigev_value.sival_ptr = notification;
+            notification->armed.store(true, std::memory_order_relaxed);
+            ++syscall_count;
+            if (mq_notify(receive_queue, &event) == -1) {
+                perror("mq_notify");
+                exit(EXIT_FAILURE);
+            }
+            if (try_receive())
+                return true;
+        }
+        ++syscall_count;
+        while (sem_wait(&notification->posted) == -1)
+            if (errno != EINTR) {
+                perror("sem_wait");
+                exit(EXIT_FAILURE);
+            }
+        return false;
+    }
+
+    auto wait_readable() -> void {
+        epoll_event event;
+        ++syscall_count;
+        if (epoll_wait(epoll_fd, &event, 1, -1) == -1 && errno != EINTR) {
+            perror("epoll_wait");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+  public:
+    explicit mqueue_transport(mqueue_wait waiting) : waiting(waiting) {}
+
+    auto max_frame_size() const -> size_t override {
+        return read_mqueue_limit("msgsize_max", default_mq_msgsize_max);
+    }
+
+    auto queues_frames() const -> bool override {
+        return true;
+    }
+
+    auto prioritises_frames() const -> bool override {
+        return true;
+    }
+
+    auto received_priority() const -> unsigned override {
+        return last_priority;
+    }
+
+    auto settings() const -> std::string override {
+        std::string schedule;
+        for (unsigned priority : priorities)
+            schedule += std::format("{}{}", schedule.empty() ? "" : "/", priority);
+        return std::format("qd={} prio={}", depth, schedule);
+    }
+
+    auto syscalls() const -> std::optional<uint64_t> override {
+        return syscall_count;
+    }
+
+    auto setup(const run_config &config) -> void override {
+        static unsigned instance = 0;
+        frame_size = config.frame_size;
+        priorities = config.mq_priorities;
+        buffer = allocate_frame(frame_size);
+
+        depth = std::min(config.queue_depth, read_mqueue_limit("msg_max", default_mq_msg_max));
+        if (depth < config.queue_depth)
+            std::cerr << std::format("POSIX mqueue depth capped at msg_max = {}", depth) << std::endl;
+
+        std::string name = std::format("/ipc-benchmark-{}-{}", getpid(), instance++);
+        mq_attr attributes{};
+        attributes.mq_maxmsg = depth;
+        attributes.mq_msgsize = frame_size;
+        send_queue = mq_open(name.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600, &attributes);
+        if (send_queue == -1) {
+            perror("mq_open");
+            exit(EXIT_FAILURE);
+        }
+        // The reader gets its own open file description, so O_NONBLOCK on
+        // it leaves the writer blocking.
+        int receive_flags = O_RDONLY | O_CLOEXEC | (waiting == mqueue_wait::blocking ? 0 : O_NONBLOCK);
+        receive_queue = mq_open(name.c_str(), receive_flags);
+        if (receive_queue == -1) {
+            perror("mq_open");
+            exit(EXIT_FAILURE);
+        }
+        mq_unlink(name.c_str());
+        if (priority_classes(priorities).size() > 1)
+            check_priority_order();
+
+        if (waiting == mqueue_wait::notify) {
+            void *memory = mmap(nullptr, sizeof(mqueue_notification), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                perror("mmap");
+                exit(EXIT_FAILURE);
+            }
+            notification = new (memory) mqueue_notification{};
+            if (sem_init(&notification->posted, 1, 0) == -1) {
+                perror("sem_init");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    auto attach(role side) -> void override {
+        if (side == role::reader && waiting == mqueue_wait::epoll) {
+            epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            epoll_event event{};
+            event.events = EPOLLIN;
+            if (epoll_fd == -1 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, receive_queue, &event) == -1) {
+                perror("epoll");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    auto begin_send() -> std::byte * override {
+        return buffer.get();
+    }
+
+    auto end_send() -> void override {
+        send(priorities[sent++ % priorities.size()]);
+    }
+
+    auto begin_receive() -> const std::byte * override {
+        while (!try_receive()) {
+            if (waiting == mqueue_wait::epoll)
+                wait_readable();
+            else if (waiting == mqueue_wait::notify && wait_notified())
+                break;
+        }
+        return buffer.get();
+    }
+
+    auto detach(role side) -> void override {
+        if (side == role::reader && waiting == mqueue_wait::epoll)
+            close(epoll_fd);
+        if (side == role::reader && waiting == mqueue_wait::notify)
+            mq_notify(receive_queue, nullptr);
+    }
+
+    auto teardown() -> void override {
+        mq_close(send_queue);
+        mq_close(receive_queue);
+        if (notification) {
+            sem_destroy(&notification->posted);
+            munmap(notification, sizeof(mqueue_notification));
+        }
+    }
+};
+
+#endif
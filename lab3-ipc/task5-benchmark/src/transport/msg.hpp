@@ -0,0 +1,85 @@
+#pragma once
+
+#ifndef TRANSPORT_MSG_H
+#define TRANSPORT_MSG_H
+
+#include "../frame.hpp"
+#include "../transport.hpp"
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <sys/msg.h>
+
+constexpr long message_type = 1;
+constexpr size_t default_msgmax = 8192;
+
+static inline auto read_kernel_limit(const char *name, size_t fallback) -> size_t {
+    std::ifstream file(std::format("/proc/sys/kernel/{}", name));
+    size_t value = fallback;
+    if (!(file >> value))
+        std::cerr << std::format("Failed to read /proc/sys/kernel/{}, assuming {}", name, fallback) << std::endl;
+    return value;
+}
+
+class msg_transport : public transport {
+  private:
+    int msgid = -1;
+    size_t frame_size = 0;
+    frame_ptr buffer; // long msg_type followed by the frame
+
+    auto payload() -> std::byte * {
+        return buffer.get() + sizeof(long);
+    }
+
+  public:
+    auto max_frame_size() const -> size_t override {
+        return read_kernel_limit("msgmax", default_msgmax);
+    }
+
+    auto setup(const run_config &config) -> void override {
+        frame_size = config.frame_size;
+        buffer = allocate_frame(sizeof(long) + frame_size);
+
+        msgid = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+        if (msgid == -1) {
+            perror("msgget");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    auto attach(role) -> void override {
+        long type = message_type;
+        std::memcpy(buffer.get(), &type, sizeof(type));
+    }
+
+    auto begin_send() -> std::byte * override {
+        return payload();
+    }
+
+    auto end_send() -> void override {
+        if (msgsnd(msgid, buffer.get(), frame_size, 0) == -1) {
+            perror("msgsnd");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    auto begin_receive() -> const std::byte * override {
+        if (msgrcv(msgid, buffer.get(), frame_size, message_type, 0) == -1) {
+            perror("msgrcv");
+            exit(EXIT_FAILURE);
+        }
+        return payload();
+    }
+
+    auto detach(role) -> void override {
+    }
+
+    auto teardown() -> void override {
+        if (msgctl(msgid, IPC_RMID, nullptr) == -1) {
+            perror("msgctl");
+            exit(EXIT_FAILURE);
+        }
+    }
+};
+
+#endif
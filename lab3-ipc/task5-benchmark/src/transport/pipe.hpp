@@ -0,0 +1,24 @@
+#pragma once
+
+#ifndef TRANSPORT_PIPE_H
+#define TRANSPORT_PIPE_H
+
+#include "stream.hpp"
+#include <unistd.h>
+
+class pipe_transport : public stream_transport {
+  public:
+    auto setup(const run_config &config) -> void override {
+        stream_transport::setup(config);
+
+        int pipe_fd[2];
+        if (pipe(pipe_fd) == -1) {
+            perror("pipe");
+            exit(EXIT_FAILURE);
+        }
+        read_fd = pipe_fd[0];
+        write_fd = pipe_fd[1];
+    }
+};
+
+#endif
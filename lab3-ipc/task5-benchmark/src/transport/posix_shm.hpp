@@ -0,0 +1,45 @@
+#pragma once
+
+#ifndef TRANSPORT_POSIX_SHM_H
+#define TRANSPORT_POSIX_SHM_H
+
+#include "eventfd_shm.hpp"
+#include "mapping.hpp"
+#include <fcntl.h>
+#include <format>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Frame in a shm_open() object. The name is unlinked as soon as it is
+// mapped; the forked reader inherits the mapping itself.
+class posix_shm_transport : public eventfd_shm_transport {
+  private:
+    static inline size_t instances = 0;
+
+  protected:
+    auto map_frame(const run_config &config) -> void override {
+        page_policy pages = config.pages;
+        if (pages == page_policy::huge) {
+            warn_huge_fallback("shm_open", "objects on /dev/shm cannot use hugetlb pages");
+            pages = page_policy::transparent;
+        }
+
+        std::string name = std::format("/ipc_benchmark_{}_{}", getpid(), instances++);
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd == -1) {
+            perror("shm_open");
+            exit(EXIT_FAILURE);
+        }
+        mapped_length = mapping_length(frame_size, pages);
+        if (ftruncate(fd, mapped_length) == -1) {
+            perror("ftruncate");
+            exit(EXIT_FAILURE);
+        }
+        shared_frame = map_shared(fd, mapped_length, pages, used_pages);
+        close(fd);
+        shm_unlink(name.c_str());
+    }
+};
+
+#endif
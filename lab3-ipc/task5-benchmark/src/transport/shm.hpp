@@ -0,0 +1,100 @@
+#pragma once
+
+#ifndef TRANSPORT_SHM_H
+#define TRANSPORT_SHM_H
+
+#include "../frame.hpp"
+#include "../transport.hpp"
+#include <cstring>
+#include <sys/sem.h>
+#include <sys/shm.h>
+
+// One SysV shared-memory frame handed back and forth with two SysV
+// semaphores, the same scheme as task2-shared_memory.
+class shm_transport : public transport {
+  private:
+    int shmid = -1;
+    int write_semid = -1;
+    int read_semid = -1;
+    size_t frame_size = 0;
+    std::byte *shared_frame = nullptr;
+    frame_ptr local_frame;
+    copy_policy copy;
+
+    static auto semaphore_op(int semid, short op) -> void {
+        struct sembuf sem_op{0, op, 0};
+        if (semop(semid, &sem_op, 1) == -1) {
+            perror(op < 0 ? "semop P" : "semop V");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    static auto create_semaphore(int val) -> int {
+        int semid = semget(IPC_PRIVATE, 1, IPC_CREAT | 0600);
+        if (semid == -1) {
+            perror("semget");
+            exit(EXIT_FAILURE);
+        }
+        if (semctl(semid, 0, SETVAL, val) == -1) {
+            perror("semctl");
+            exit(EXIT_FAILURE);
+        }
+        return semid;
+    }
+
+  public:
+    auto settings() const -> std::string override {
+        return copy_settings(copy);
+    }
+
+    auto setup(const run_config &config) -> void override {
+        frame_size = config.frame_size;
+        local_frame = allocate_frame(frame_size);
+        copy = config.copy;
+
+        shmid = shmget(IPC_PRIVATE, frame_size, IPC_CREAT | 0600);
+        if (shmid == -1) {
+            perror("shmget");
+            exit(EXIT_FAILURE);
+        }
+        write_semid = create_semaphore(1);
+        read_semid = create_semaphore(0);
+    }
+
+    auto attach(role) -> void override {
+        void *shared_memory = shmat(shmid, nullptr, 0);
+        if (shared_memory == (void *)-1) {
+            perror("shmat");
+            exit(EXIT_FAILURE);
+        }
+        shared_frame = static_cast<std::byte *>(shared_memory);
+    }
+
+    auto begin_send() -> std::byte * override {
+        semaphore_op(write_semid, -1);
+        return shared_frame;
+    }
+
+    auto end_send() -> void override {
+        semaphore_op(read_semid, 1);
+    }
+
+    auto begin_receive() -> const std::byte * override {
+        semaphore_op(read_semid, -1);
+        copy_frame(local_frame.get(), shared_frame, frame_size, copy);
+        semaphore_op(write_semid, 1);
+        return local_frame.get();
+    }
+
+    auto detach(role) -> void override {
+        shmdt(shared_frame);
+    }
+
+    auto teardown() -> void override {
+        shmctl(shmid, IPC_RMID, nullptr);
+        semctl(write_semid, 0, IPC_RMID);
+        semctl(read_semid, 0, IPC_RMID);
+    }
+};
+
+#endif
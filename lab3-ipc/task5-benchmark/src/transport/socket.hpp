@@ -0,0 +1,65 @@
+#pragma once
+
+#ifndef TRANSPORT_SOCKET_H
+#define TRANSPORT_SOCKET_H
+
+#include "../transport.hpp"
+#include <algorithm>
+#include <climits>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+
+constexpr size_t default_wmem_max = 212992;
+
+static inline auto read_net_limit(const char *name, size_t fallback) -> size_t {
+    std::ifstream file(std::format("/proc/sys/net/core/{}", name));
+    size_t value = fallback;
+    if (!(file >> value))
+        std::cerr << std::format("Failed to read /proc/sys/net/core/{}, assuming {}", name, fallback) << std::endl;
+    return value;
+}
+
+static inline auto socket_buffer(int fd, int option) -> int {
+    int value;
+    socklen_t length = sizeof(value);
+    if (getsockopt(fd, SOL_SOCKET, option, &value, &length) == -1) {
+        perror("getsockopt");
+        exit(EXIT_FAILURE);
+    }
+    return value;
+}
+
+static inline auto set_socket_buffer(int fd, int option, size_t bytes) -> void {
+    int value = std::min<size_t>(bytes, INT_MAX);
+    if (setsockopt(fd, SOL_SOCKET, option, &value, sizeof(value)) == -1) {
+        perror("setsockopt");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// SO_SNDBUF on the writing end and SO_RCVBUF on the reading end as given by
+// --sndbuf and --rcvbuf; 0 keeps the kernel default. The kernel doubles a
+// request for its own bookkeeping and caps it at net.core.wmem_max and
+// rmem_max, so what is reported is read back afterwards.
+struct socket_buffers {
+    int send = 0;
+    int receive = 0;
+
+    auto apply(int write_fd, int read_fd, const run_config &config) -> void {
+        if (config.send_buffer)
+            set_socket_buffer(write_fd, SO_SNDBUF, config.send_buffer);
+        if (config.receive_buffer)
+            set_socket_buffer(read_fd, SO_RCVBUF, config.receive_buffer);
+        send = socket_buffer(write_fd, SO_SNDBUF);
+        receive = socket_buffer(read_fd, SO_RCVBUF);
+    }
+
+    auto describe() const -> std::string {
+        return std::format("sndbuf={} rcvbuf={}", send, receive);
+    }
+};
+
+#endif
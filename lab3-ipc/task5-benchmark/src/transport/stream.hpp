@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef TRANSPORT_STREAM_H
+#define TRANSPORT_STREAM_H
+
+#include "../frame.hpp"
+#include "../transport.hpp"
+#include <unistd.h>
+
+// Base for byte-stream transports: every frame is copied in with write()
+// and out with read() through a private buffer on each side.
+class stream_transport : public transport {
+  protected:
+    int write_fd = -1;
+    int read_fd = -1;
+    size_t frame_size = 0;
+    frame_ptr buffer;
+    uint64_t syscall_count = 0;
+
+  public:
+    auto setup(const run_config &config) -> void override {
+        frame_size = config.frame_size;
+        buffer = allocate_frame(frame_size);
+    }
+
+    auto begin_send() -> std::byte * override {
+        return buffer.get();
+    }
+
+    auto end_send() -> void override {
+        syscall_count += write_all(write_fd, buffer.get(), frame_size);
+    }
+
+    auto begin_receive() -> const std::byte * override {
+        syscall_count += read_all(read_fd, buffer.get(), frame_size);
+        return buffer.get();
+    }
+
+    auto syscalls() const -> std::optional<uint64_t> override {
+        return syscall_count;
+    }
+
+    auto attach(role side) -> void override {
+        close(side == role::writer ? read_fd : write_fd);
+    }
+
+    auto detach(role side) -> void override {
+        close(side == role::writer ? write_fd : read_fd);
+    }
+};
+
+#endif
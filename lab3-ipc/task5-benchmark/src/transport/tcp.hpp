@@ -0,0 +1,215 @@
+#pragma once
+
+#ifndef TRANSPORT_TCP_H
+#define TRANSPORT_TCP_H
+
+#include "../frame.hpp"
+#include "socket.hpp"
+#include "stream.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <format>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <vector>
+
+static inline auto set_socket_option(int fd, int level, int option, int value, const char *what) -> bool {
+    if (setsockopt(fd, level, option, &value, sizeof(value)) == -1) {
+        perror(what);
+        return false;
+    }
+    return true;
+}
+
+// A connection over 127.0.0.1: the parent listens on an ephemeral port,
+// connects and accepts before fork(), so both ends already exist when the
+// writer and reader start. --tcp-nodelay (default on) disables Nagle on
+// both ends and --busy-poll sets SO_BUSY_POLL on the receiving one; a
+// setting the kernel refuses is reported and the run goes on without it.
+//
+// With zero copy the writer sends with MSG_ZEROCOPY from a ring of
+// queue_depth frame buffers. The kernel pins the pages instead of copying
+// them and reports on the socket's error queue, as a range of send() calls,
+// when it has let go of them; a buffer is refilled only once its last
+// send() is covered. TCP reports the ranges in order, so a count of
+// completed calls is enough. Traffic looped back to a local socket is
+// copied when it is delivered anyway; such completions carry
+// SO_EE_CODE_ZEROCOPY_COPIED and the share of them is reported.
+class tcp_transport : public stream_transport {
+  private:
+    bool zerocopy;
+    bool nodelay = false;
+    int busy_poll = 0;
+    socket_buffers buffers;
+
+    size_t depth = 1;
+    frame_ptr ring;
+    std::vector<uint64_t> slot_call; // zero copy: send() call number + 1 that last used the slot
+    size_t next_slot = 0;
+    uint64_t calls_issued = 0;
+    uint64_t calls_completed = 0;
+    uint64_t calls_copied = 0;
+
+    auto slot(size_t index) -> std::byte * {
+        return ring.get() + index * frame_size;
+    }
+
+    // Takes every notification on the error queue; blocks for one first if
+    // `wait` is set.
+    auto reap_completions(bool wait) -> void {
+        while (true) {
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(sock_extended_err)) + 64];
+            msghdr message{};
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            ++syscall_count;
+            if (recvmsg(write_fd, &message, MSG_ERRQUEUE) == -1) {
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN) {
+                    perror("recvmsg MSG_ERRQUEUE");
+                    exit(EXIT_FAILURE);
+                }
+                if (!wait)
+                    return;
+                // POLLERR is always reported, whatever the requested events.
+                pollfd error_queue{write_fd, 0, 0};
+                ++syscall_count;
+                if (poll(&error_queue, 1, -1) == -1 && errno != EINTR) {
+                    perror("poll");
+                    exit(EXIT_FAILURE);
+                }
+                continue;
+            }
+            for (cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+                bool ip_error = (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR);
+                auto *error = reinterpret_cast<sock_extended_err *>(CMSG_DATA(cmsg));
+                if (!ip_error || error->ee_errno != 0 || error->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                    continue;
+                uint64_t completed = static_cast<uint32_t>(error->ee_data - error->ee_info) + 1;
+                calls_completed += completed;
+                if (error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                    calls_copied += completed;
+            }
+            wait = false;
+        }
+    }
+
+    auto send_zerocopy(const std::byte *data) -> void {
+        const std::byte *end = data + frame_size;
+        while (data != end) {
+            ++syscall_count;
+            auto sent = send(write_fd, data, end - data, MSG_ZEROCOPY | MSG_NOSIGNAL);
+            if (sent == -1) {
+                if (errno == EINTR)
+                    continue;
+                // Each zero-copy send() pins memory charged to optmem_max
+                // until its notification has been read.
+                if (errno == ENOBUFS && calls_completed != calls_issued) {
+                    reap_completions(true);
+                    continue;
+                }
+                perror("send MSG_ZEROCOPY");
+                exit(EXIT_FAILURE);
+            }
+            ++calls_issued;
+            data += sent;
+        }
+    }
+
+    auto connect_loopback() -> void {
+        int listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listener == -1) {
+            perror("socket");
+            exit(EXIT_FAILURE);
+        }
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        if (bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == -1 || listen(listener, 1) == -1 ||
+            getsockname(listener, reinterpret_cast<sockaddr *>(&address), &length) == -1) {
+            perror("listen on loopback");
+            exit(EXIT_FAILURE);
+        }
+        write_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (write_fd == -1 || connect(write_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == -1) {
+            perror("connect to loopback");
+            exit(EXIT_FAILURE);
+        }
+        read_fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (read_fd == -1) {
+            perror("accept4");
+            exit(EXIT_FAILURE);
+        }
+        close(listener);
+    }
+
+  public:
+    explicit tcp_transport(bool zerocopy) : zerocopy(zerocopy) {}
+
+    auto queues_frames() const -> bool override {
+        return zerocopy;
+    }
+
+    auto settings() const -> std::string override {
+        std::string result = std::format("{}busy_poll={} {}", nodelay ? "nodelay " : "", busy_poll, buffers.describe());
+        if (zerocopy && calls_completed != 0)
+            result += std::format(" qd={} zc_copied={:.0f}%", depth, 100.0 * calls_copied / calls_completed);
+        else if (zerocopy)
+            result += std::format(" qd={}", depth);
+        return result;
+    }
+
+    auto setup(const run_config &config) -> void override {
+        stream_transport::setup(config);
+        connect_loopback();
+        buffers.apply(write_fd, read_fd, config);
+
+        if (config.tcp_nodelay)
+            nodelay = set_socket_option(write_fd, IPPROTO_TCP, TCP_NODELAY, 1, "setsockopt TCP_NODELAY") &&
+                      set_socket_option(read_fd, IPPROTO_TCP, TCP_NODELAY, 1, "setsockopt TCP_NODELAY");
+        if (config.busy_poll && set_socket_option(read_fd, SOL_SOCKET, SO_BUSY_POLL, config.busy_poll, "setsockopt SO_BUSY_POLL"))
+            busy_poll = config.busy_poll;
+
+        if (zerocopy) {
+            if (!set_socket_option(write_fd, SOL_SOCKET, SO_ZEROCOPY, 1, "setsockopt SO_ZEROCOPY"))
+                exit(EXIT_FAILURE);
+            depth = config.queue_depth;
+            ring = allocate_frame(depth * frame_size);
+            slot_call.assign(depth, 0);
+        }
+    }
+
+    auto begin_send() -> std::byte * override {
+        if (!zerocopy)
+            return stream_transport::begin_send();
+        while (calls_completed < slot_call[next_slot])
+            reap_completions(true);
+        return slot(next_slot);
+    }
+
+    auto end_send() -> void override {
+        if (!zerocopy) {
+            stream_transport::end_send();
+            return;
+        }
+        send_zerocopy(slot(next_slot));
+        slot_call[next_slot] = calls_issued;
+        next_slot = (next_slot + 1) % depth;
+        reap_completions(false);
+    }
+
+    // The writer's buffers have to stay put until the kernel is done with them.
+    auto detach(role side) -> void override {
+        if (side == role::writer && zerocopy)
+            while (calls_completed != calls_issued)
+                reap_completions(true);
+        stream_transport::detach(side);
+    }
+};
+
+#endif
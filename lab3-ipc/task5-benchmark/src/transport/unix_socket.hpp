@@ -0,0 +1,248 @@
+#pragma once
+
+#ifndef TRANSPORT_UNIX_SOCKET_H
+#define TRANSPORT_UNIX_SOCKET_H
+
+#include "../frame.hpp"
+#include "socket.hpp"
+#include "stream.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <format>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
+
+constexpr size_t unix_message_overhead = 32; // a SOCK_SEQPACKET message may use sk_sndbuf minus this
+
+static inline auto create_socketpair(int type, int &write_fd, int &read_fd) -> void {
+    int socket_fd[2];
+    if (socketpair(AF_UNIX, type, 0, socket_fd) == -1) {
+        perror("socketpair");
+        exit(EXIT_FAILURE);
+    }
+    write_fd = socket_fd[0];
+    read_fd = socket_fd[1];
+}
+
+// AF_UNIX charges queued data to the sender, so SO_SNDBUF is the buffer
+// that matters here.
+class unix_socket_transport : public stream_transport {
+  private:
+    socket_buffers buffers;
+
+  public:
+    auto settings() const -> std::string override {
+        return buffers.describe();
+    }
+
+    auto setup(const run_config &config) -> void override {
+        stream_transport::setup(config);
+        create_socketpair(SOCK_STREAM, write_fd, read_fd);
+        buffers.apply(write_fd, read_fd, config);
+    }
+};
+
+// Up to queue_depth frames per syscall over a socketpair, each frame in a
+// buffer of its own. SOCK_STREAM gathers the filled frames into one
+// sendmsg() and scatters whatever has arrived across the free ones with
+// recvmsg(), finishing a frame that arrived only in part with read().
+// SOCK_SEQPACKET keeps one message per frame and moves the batch with
+// sendmmsg() and recvmmsg(MSG_WAITFORONE), so the reader never waits for
+// more than the first one. The writer sends once the batch is full, and
+// whatever is left over when it detaches; in pingpong mode every frame
+// waits for its echo, so the batch is a single frame there.
+class unix_batch_transport : public transport {
+  private:
+    int type;
+    int write_fd = -1;
+    int read_fd = -1;
+    size_t frame_size = 0;
+    size_t batch = 1;
+    size_t remaining = 0; // reader: frames not yet received
+    socket_buffers buffers;
+    std::vector<frame_ptr> slots;
+    std::vector<iovec> iovecs;     // one per slot
+    std::vector<mmsghdr> messages; // SOCK_SEQPACKET: one per slot
+    size_t filled = 0;             // writer: frames waiting to go out
+    size_t received = 0;           // reader: frames in the slots
+    size_t next = 0;               // reader: next frame to hand out
+    uint64_t syscall_count = 0;
+
+    auto reset_iovecs() -> void {
+        for (size_t i = 0; i < batch; ++i)
+            iovecs[i] = {slots[i].get(), frame_size};
+    }
+
+    auto send_stream() -> void {
+        reset_iovecs();
+        msghdr message{};
+        message.msg_iov = iovecs.data();
+        message.msg_iovlen = filled;
+        for (size_t left = filled * frame_size; left != 0;) {
+            ++syscall_count;
+            auto sent = sendmsg(write_fd, &message, MSG_NOSIGNAL);
+            if (sent == -1) {
+                if (errno == EINTR)
+                    continue;
+                perror("sendmsg");
+                exit(EXIT_FAILURE);
+            }
+            left -= sent;
+            // Skip what went out and resume inside the first partial frame.
+            for (; message.msg_iovlen != 0 && static_cast<size_t>(sent) >= message.msg_iov->iov_len; --message.msg_iovlen)
+                sent -= message.msg_iov++->iov_len;
+            if (message.msg_iovlen != 0) {
+                message.msg_iov->iov_base = static_cast<std::byte *>(message.msg_iov->iov_base) + sent;
+                message.msg_iov->iov_len -= sent;
+            }
+        }
+    }
+
+    auto send_messages() -> void {
+        for (size_t sent = 0; sent < filled;) {
+            ++syscall_count;
+            int result = sendmmsg(write_fd, messages.data() + sent, filled - sent, MSG_NOSIGNAL);
+            if (result == -1) {
+                if (errno == EINTR)
+                    continue;
+                perror("sendmmsg");
+                exit(EXIT_FAILURE);
+            }
+            sent += result;
+        }
+    }
+
+    auto flush() -> void {
+        if (filled == 0)
+            return;
+        if (type == SOCK_STREAM)
+            send_stream();
+        else
+            send_messages();
+        filled = 0;
+    }
+
+    auto receive_stream() -> size_t {
+        reset_iovecs();
+        msghdr message{};
+        message.msg_iov = iovecs.data();
+        message.msg_iovlen = batch;
+        ssize_t bytes;
+        do {
+            ++syscall_count;
+            bytes = recvmsg(read_fd, &message, 0);
+        } while (bytes == -1 && errno == EINTR);
+        if (bytes == -1) {
+            perror("recvmsg");
+            exit(EXIT_FAILURE);
+        }
+        if (bytes == 0) {
+            std::fputs("recvmsg: unexpected end of stream\n", stderr);
+            exit(EXIT_FAILURE);
+        }
+        size_t frames = bytes / frame_size;
+        size_t rest = bytes % frame_size;
+        if (rest != 0)
+            syscall_count += read_all(read_fd, slots[frames++].get() + rest, frame_size - rest);
+        return frames;
+    }
+
+    // Asks for no more than the frames still to come: past the last one the
+    // writer has hung up, and recvmmsg() would count that as an empty message.
+    auto receive_messages() -> size_t {
+        int frames;
+        do {
+            ++syscall_count;
+            frames = recvmmsg(read_fd, messages.data(), std::min(batch, remaining), MSG_WAITFORONE, nullptr);
+        } while (frames == -1 && errno == EINTR);
+        if (frames == -1) {
+            perror("recvmmsg");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < frames; ++i)
+            if (messages[i].msg_len != frame_size || messages[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                std::cerr << std::format("recvmmsg: message of {} B instead of {} B", messages[i].msg_len, frame_size) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        return frames;
+    }
+
+  public:
+    explicit unix_batch_transport(int type) : type(type) {}
+
+    // One SOCK_SEQPACKET message has to fit the send buffer, which can grow
+    // to twice net.core.wmem_max.
+    auto max_frame_size() const -> size_t override {
+        if (type == SOCK_STREAM)
+            return SIZE_MAX;
+        return 2 * read_net_limit("wmem_max", default_wmem_max) - unix_message_overhead;
+    }
+
+    auto queues_frames() const -> bool override {
+        return true;
+    }
+
+    auto settings() const -> std::string override {
+        return std::format("batch={} {}", batch, buffers.describe());
+    }
+
+    auto syscalls() const -> std::optional<uint64_t> override {
+        return syscall_count;
+    }
+
+    auto setup(const run_config &config) -> void override {
+        frame_size = config.frame_size;
+        batch = config.round_trip ? 1 : config.queue_depth;
+        remaining = config.frames;
+        create_socketpair(type, write_fd, read_fd);
+        buffers.apply(write_fd, read_fd, config);
+        if (type == SOCK_SEQPACKET && static_cast<size_t>(buffers.send) < frame_size + unix_message_overhead) {
+            set_socket_buffer(write_fd, SO_SNDBUF, (frame_size + unix_message_overhead + 1) / 2);
+            buffers.send = socket_buffer(write_fd, SO_SNDBUF);
+            std::cerr << std::format("SO_SNDBUF raised to {} to fit a {} B message", buffers.send, frame_size) << std::endl;
+        }
+
+        for (size_t i = 0; i < batch; ++i)
+            slots.push_back(allocate_frame(frame_size));
+        iovecs.resize(batch);
+        reset_iovecs();
+        messages.resize(batch);
+        for (size_t i = 0; i < batch; ++i) {
+            messages[i].msg_hdr = msghdr{};
+            messages[i].msg_hdr.msg_iov = &iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    auto attach(role side) -> void override {
+        close(side == role::writer ? read_fd : write_fd);
+    }
+
+    auto begin_send() -> std::byte * override {
+        return slots[filled].get();
+    }
+
+    auto end_send() -> void override {
+        if (++filled == batch)
+            flush();
+    }
+
+    auto begin_receive() -> const std::byte * override {
+        if (next == received) {
+            received = type == SOCK_STREAM ? receive_stream() : receive_messages();
+            remaining -= received;
+            next = 0;
+        }
+        return slots[next++].get();
+    }
+
+    auto detach(role side) -> void override {
+        if (side == role::writer)
+            flush();
+        close(side == role::writer ? write_fd : read_fd);
+    }
+};
+
+#endif
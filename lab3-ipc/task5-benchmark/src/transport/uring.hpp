@@ -0,0 +1,177 @@
+#pragma once
+
+#ifndef TRANSPORT_URING_H
+#define TRANSPORT_URING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// A minimal io_uring built on the raw syscalls, enough for queueing reads and
+// writes and reaping their completions. Every io_uring_enter() is counted.
+class uring {
+  private:
+    int fd = -1;
+    bool polling = false;
+    void *sq_ring = MAP_FAILED;
+    void *cq_ring = MAP_FAILED;
+    size_t sq_ring_size = 0;
+    size_t cq_ring_size = 0;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    size_t sqes_size = 0;
+
+    unsigned *sq_head = nullptr;
+    unsigned *sq_tail = nullptr;
+    unsigned *sq_mask = nullptr;
+    unsigned *sq_flags = nullptr;
+    unsigned *sq_array = nullptr;
+    unsigned *cq_head = nullptr;
+    unsigned *cq_tail = nullptr;
+    unsigned *cq_mask = nullptr;
+    io_uring_cqe *cqes = nullptr;
+
+    unsigned pending = 0; // queued entries not yet handed to the kernel
+
+    static auto map_ring(int fd, size_t length, off_t offset) -> void * {
+        void *memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+        if (memory == MAP_FAILED) {
+            perror("mmap io_uring");
+            exit(EXIT_FAILURE);
+        }
+        return memory;
+    }
+
+    static auto load(unsigned *value) -> unsigned {
+        return std::atomic_ref<unsigned>(*value).load(std::memory_order_acquire);
+    }
+
+    static auto store(unsigned *value, unsigned next) -> void {
+        std::atomic_ref<unsigned>(*value).store(next, std::memory_order_release);
+    }
+
+    auto enter(unsigned to_submit, unsigned min_complete, unsigned flags) -> void {
+        ++enter_count;
+        while (syscall(SYS_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0) == -1) {
+            if (errno == EINTR)
+                continue;
+            perror("io_uring_enter");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+  public:
+    uint64_t enter_count = 0;
+
+    // Returns whether the submission queue is polled by a kernel thread;
+    // when SQPOLL is refused the ring is created without it.
+    auto init(unsigned entries, bool sqpoll) -> bool {
+        io_uring_params params{};
+        if (sqpoll) {
+            params.flags = IORING_SETUP_SQPOLL;
+            params.sq_thread_idle = 1000;
+        }
+        fd = syscall(SYS_io_uring_setup, entries, &params);
+        if (fd == -1 && sqpoll) {
+            perror("io_uring_setup with SQPOLL, falling back to plain submission");
+            params = io_uring_params{};
+            fd = syscall(SYS_io_uring_setup, entries, &params);
+        }
+        if (fd == -1) {
+            perror("io_uring_setup");
+            exit(EXIT_FAILURE);
+        }
+        polling = params.flags & IORING_SETUP_SQPOLL;
+
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+            sq_ring = map_ring(fd, sq_ring_size, IORING_OFF_SQ_RING);
+            cq_ring = sq_ring;
+        } else {
+            sq_ring = map_ring(fd, sq_ring_size, IORING_OFF_SQ_RING);
+            cq_ring = map_ring(fd, cq_ring_size, IORING_OFF_CQ_RING);
+        }
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe *>(map_ring(fd, sqes_size, IORING_OFF_SQES));
+
+        auto *sq = static_cast<char *>(sq_ring);
+        auto *cq = static_cast<char *>(cq_ring);
+        sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sq_flags = reinterpret_cast<unsigned *>(sq + params.sq_off.flags);
+        sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        return polling;
+    }
+
+    // Queues a read or write; nothing reaches the kernel before submit().
+    auto queue(uint8_t opcode, int target, void *data, unsigned length, uint64_t user_data, uint8_t flags) -> void {
+        unsigned tail = *sq_tail;
+        unsigned index = tail & *sq_mask;
+        io_uring_sqe *sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->fd = target;
+        sqe->addr = reinterpret_cast<uint64_t>(data);
+        sqe->len = length;
+        sqe->off = -1; // current file position, as read() and write() would
+        sqe->flags = flags;
+        sqe->user_data = user_data;
+        sq_array[index] = index;
+        store(sq_tail, tail + 1);
+        ++pending;
+    }
+
+    auto submit() -> void {
+        if (pending == 0)
+            return;
+        if (polling) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (std::atomic_ref<unsigned>(*sq_flags).load(std::memory_order_relaxed) & IORING_SQ_NEED_WAKEUP)
+                enter(0, 0, IORING_ENTER_SQ_WAKEUP);
+        } else
+            enter(pending, 0, 0);
+        pending = 0;
+    }
+
+    // Blocks until at least one completion is available.
+    auto wait() -> void {
+        if (load(cq_tail) == *cq_head)
+            enter(0, 1, IORING_ENTER_GETEVENTS);
+    }
+
+    auto peek(io_uring_cqe &cqe) -> bool {
+        unsigned head = *cq_head;
+        if (head == load(cq_tail))
+            return false;
+        cqe = cqes[head & *cq_mask];
+        store(cq_head, head + 1);
+        return true;
+    }
+
+    auto close() -> void {
+        if (fd == -1)
+            return;
+        munmap(sqes, sqes_size);
+        if (cq_ring != sq_ring)
+            munmap(cq_ring, cq_ring_size);
+        munmap(sq_ring, sq_ring_size);
+        ::close(fd);
+        fd = -1;
+    }
+};
+
+#endif
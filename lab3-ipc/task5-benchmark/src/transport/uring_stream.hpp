@@ -0,0 +1,192 @@
+#pragma once
+
+#ifndef TRANSPORT_URING_STREAM_H
+#define TRANSPORT_URING_STREAM_H
+
+#include "../frame.hpp"
+#include "uring.hpp"
+#include <climits>
+#include <format>
+
+// Drives the descriptors of a pipe or FIFO transport through io_uring. Each
+// side owns queue_depth frame buffers. Filled (writer) or free (reader)
+// buffers are submitted as one linked chain, so the kernel performs the
+// transfers in stream order, and the next chain only goes out once the
+// previous one has completed; whatever piled up meanwhile forms the next
+// batch. A short transfer breaks the chain and cancels the rest; those
+// frames simply go out again, resuming where they stopped.
+template <typename stream_t>
+class uring_transport : public stream_t {
+  private:
+    size_t depth = 0;
+    size_t total_frames = 0;
+    bool round_trip = false;
+    bool sqpoll_requested = false;
+    bool sqpoll_used = false;
+    frame_ptr buffers;
+    uring ring;
+    role side = role::writer;
+
+    // Frames are numbered in stream order and frame f lives in slot f % depth.
+    size_t completed = 0;  // frames fully transferred
+    size_t partial = 0;    // bytes of frame `completed` already transferred
+    size_t chain_end = 0;  // frames [completed, chain_end) are in flight
+    size_t available = 0;  // writer: frames filled, reader: frames handed out
+    size_t released = 0;   // reader: frames given back with end_receive()
+
+    auto slot(size_t frame) -> std::byte * {
+        return buffers.get() + (frame % depth) * this->frame_size;
+    }
+
+    auto in_flight() const -> bool {
+        return chain_end != completed;
+    }
+
+    auto submit_chain(size_t end) -> void {
+        const uint8_t opcode = side == role::writer ? IORING_OP_WRITE : IORING_OP_READ;
+        const int fd = side == role::writer ? this->write_fd : this->read_fd;
+        for (size_t frame = completed; frame < end; ++frame) {
+            size_t offset = frame == completed ? partial : 0;
+            ring.queue(opcode, fd, slot(frame) + offset, this->frame_size - offset, frame,
+                       frame + 1 < end ? IOSQE_IO_LINK : 0);
+        }
+        ring.submit();
+        chain_end = end;
+    }
+
+    // A short transfer has ended the chain. The writer sends the rest of
+    // that frame, and whatever was filled meanwhile, straight away rather
+    // than whenever it next comes back to the ring.
+    auto end_chain() -> void {
+        chain_end = completed;
+        if (side == role::writer && available != completed)
+            submit_chain(available);
+    }
+
+    // Reaps whatever has completed, then keeps waiting while fewer than
+    // `target` frames are complete and the chain is still in flight.
+    auto reap(size_t target) -> void {
+        io_uring_cqe cqe;
+        while (in_flight()) {
+            if (!ring.peek(cqe)) {
+                if (completed >= target)
+                    return;
+                ring.wait();
+                continue;
+            }
+            size_t frame = cqe.user_data;
+            if (cqe.res == -ECANCELED) {
+                if (frame + 1 == chain_end)
+                    end_chain();
+                continue;
+            }
+            if (cqe.res < 0) {
+                errno = -cqe.res;
+                perror(side == role::writer ? "io_uring write" : "io_uring read");
+                exit(EXIT_FAILURE);
+            }
+            if (cqe.res == 0) {
+                std::fputs("io_uring read: unexpected end of stream\n", stderr);
+                exit(EXIT_FAILURE);
+            }
+            partial += cqe.res;
+            if (partial == this->frame_size) {
+                partial = 0;
+                ++completed;
+            } else if (frame + 1 == chain_end)
+                end_chain();
+            // Otherwise the rest of the chain is cancelled and drains before
+            // anything is resubmitted.
+        }
+    }
+
+    // Writer: wait until every filled frame has been written out.
+    auto drain() -> void {
+        while (completed != available) {
+            if (!in_flight())
+                submit_chain(available);
+            reap(available);
+        }
+    }
+
+    // Reader: start reads into every free slot.
+    auto refill() -> void {
+        size_t end = std::min(released + depth, total_frames);
+        if (!in_flight() && end > completed)
+            submit_chain(end);
+    }
+
+  public:
+    auto queues_frames() const -> bool override {
+        return true;
+    }
+
+    auto settings() const -> std::string override {
+        return std::format("qd={}{}", depth, sqpoll_used ? " sqpoll" : "");
+    }
+
+    auto syscalls() const -> std::optional<uint64_t> override {
+        return ring.enter_count;
+    }
+
+    auto setup(const run_config &config) -> void override {
+        stream_t::setup(config);
+        depth = config.queue_depth;
+        total_frames = config.frames;
+        round_trip = config.round_trip;
+        sqpoll_requested = config.sqpoll;
+        buffers = allocate_frame(depth * config.frame_size);
+    }
+
+    auto attach(role which) -> void override {
+        stream_t::attach(which);
+        side = which;
+        sqpoll_used = ring.init(depth, sqpoll_requested);
+    }
+
+    auto begin_send() -> std::byte * override {
+        while (available - completed == depth) {
+            if (!in_flight())
+                submit_chain(available);
+            reap(available - depth + 1);
+        }
+        if (!in_flight() && available != completed)
+            submit_chain(available);
+        return slot(available);
+    }
+
+    auto end_send() -> void override {
+        ++available;
+        reap(0);
+        if (!in_flight())
+            submit_chain(available);
+        // A write above PIPE_BUF can complete short, and only the writer can
+        // send the rest. In pingpong mode it waits for the echo instead of
+        // coming back to the ring, so such frames are finished here.
+        if (round_trip && this->frame_size > PIPE_BUF)
+            drain();
+    }
+
+    auto begin_receive() -> const std::byte * override {
+        while (completed == available) {
+            refill();
+            reap(available + 1);
+        }
+        return slot(available++);
+    }
+
+    auto end_receive() -> void override {
+        ++released;
+        reap(0);
+        refill();
+    }
+
+    auto detach(role which) -> void override {
+        if (which == role::writer)
+            drain();
+        ring.close();
+        stream_t::detach(which);
+    }
+};
+
+#endif
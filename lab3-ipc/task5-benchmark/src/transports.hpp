@@ -0,0 +1,86 @@
+#pragma once
+
+#ifndef TRANSPORTS_H
+#define TRANSPORTS_H
+
+#include "transport.hpp"
+#include "transport/eventfd_shm.hpp"
+#include "transport/fifo.hpp"
+#include "transport/memfd.hpp"
+#include "transport/memfd_scm.hpp"
+#include "transport/mqueue.hpp"
+#include "transport/msg.hpp"
+#include "transport/pipe.hpp"
+#include "transport/posix_shm.hpp"
+#include "transport/shm.hpp"
+#include "transport/tcp.hpp"
+#include "transport/unix_socket.hpp"
+#include "transport/uring_stream.hpp"
+#include <memory>
+#include <string_view>
+
+constexpr std::string_view transport_names[] = {
+    "msg",
+    "shm",
+    "pipe",
+    "fifo",
+    "unix",
+    "eventfd_shm",
+    "posix_shm",
+    "memfd",
+    "memfd_scm",
+    "memfd_scm_pool",
+    "pipe_uring",
+    "fifo_uring",
+    "mqueue",
+    "mqueue_epoll",
+    "mqueue_notify",
+    "unix_iov",
+    "unix_seqpacket",
+    "tcp",
+    "tcp_zerocopy",
+};
+
+static inline auto make_transport(std::string_view name) -> std::unique_ptr<transport> {
+    if (name == "msg")
+        return std::make_unique<msg_transport>();
+    if (name == "shm")
+        return std::make_unique<shm_transport>();
+    if (name == "pipe")
+        return std::make_unique<pipe_transport>();
+    if (name == "fifo")
+        return std::make_unique<fifo_transport>();
+    if (name == "unix")
+        return std::make_unique<unix_socket_transport>();
+    if (name == "eventfd_shm")
+        return std::make_unique<eventfd_shm_transport>();
+    if (name == "posix_shm")
+        return std::make_unique<posix_shm_transport>();
+    if (name == "memfd")
+        return std::make_unique<memfd_transport>();
+    if (name == "memfd_scm")
+        return std::make_unique<memfd_scm_transport>(false);
+    if (name == "memfd_scm_pool")
+        return std::make_unique<memfd_scm_transport>(true);
+    if (name == "pipe_uring")
+        return std::make_unique<uring_transport<pipe_transport>>();
+    if (name == "fifo_uring")
+        return std::make_unique<uring_transport<fifo_transport>>();
+    if (name == "mqueue")
+        return std::make_unique<mqueue_transport>(mqueue_wait::blocking);
+    if (name == "mqueue_epoll")
+        return std::make_unique<mqueue_transport>(mqueue_wait::epoll);
+    if (name == "mqueue_notify")
+        return std::make_unique<mqueue_transport>(mqueue_wait::notify);
+    if (name == "unix_iov")
+        return std::make_unique<unix_batch_transport>(SOCK_STREAM);
+    if (name == "unix_seqpacket")
+        return std::make_unique<unix_batch_transport>(SOCK_SEQPACKET);
+    if (name == "tcp")
+        return std::make_unique<tcp_transport>(false);
+    if (name == "tcp_zerocopy")
+        return std::make_unique<tcp_transport>(true);
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,136 @@
+#pragma once
+
+#ifndef WAKEUP_BENCHMARK_H
+#define WAKEUP_BENCHMARK_H
+
+#include "histogram.hpp"
+#include "notifier.hpp"
+#include "options.hpp"
+#include "placement.hpp"
+#include "report.hpp"
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// --mode=wakeup: the two processes bounce a notification back and forth
+// and nothing else. Whoever notifies stamps the time first, and the woken
+// side records how long it took to get from that stamp to running again.
+// Both directions go into the histogram; the round trips give the highest
+// rate of wake-ups the path sustains.
+struct wakeup_shared {
+    std::atomic<uint64_t> sent_at;
+    latency_histogram reader_latency;
+};
+
+static inline auto wakeup_received(wakeup_shared *shared, latency_histogram &latency, bool measured) -> void {
+    if (measured)
+        latency.record(monotonic_ns() - shared->sent_at.load(std::memory_order_acquire));
+}
+
+static inline auto wakeup_writer(notifier &channel, wakeup_shared *shared, const options &opts, latency_histogram &latency) -> double {
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < opts.warmup + opts.rounds; ++i) {
+        if (i == opts.warmup)
+            start_time = std::chrono::high_resolution_clock::now();
+        shared->sent_at.store(monotonic_ns(), std::memory_order_release);
+        channel.notify();
+        channel.wait();
+        wakeup_received(shared, latency, i >= opts.warmup);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start_time;
+    return elapsed.count();
+}
+
+static inline auto wakeup_reader(notifier &channel, wakeup_shared *shared, const options &opts) -> void {
+    for (size_t i = 0; i < opts.warmup + opts.rounds; ++i) {
+        channel.wait();
+        wakeup_received(shared, shared->reader_latency, i >= opts.warmup);
+        shared->sent_at.store(monotonic_ns(), std::memory_order_release);
+        channel.notify();
+    }
+}
+
+// "BOUND:COUNT" per non-empty power of two, COUNT wake-ups that took less
+// than BOUND ns and at least half of it. Spaces keep it in one CSV cell.
+static inline auto histogram_summary(const latency_histogram &latency) -> std::string {
+    std::string result;
+    for (auto [bound, count] : latency.power_of_two_counts())
+        result += std::format("{}{}:{}", result.empty() ? "" : " ", bound, count);
+    return result;
+}
+
+static inline auto wakeup_benchmark(std::string_view name, const run_placement &place, const options &opts) -> record {
+    auto channel = make_notifier(name);
+    channel->setup();
+
+    void *memory = mmap(nullptr, sizeof(wakeup_shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    wakeup_shared *shared = new (memory) wakeup_shared{};
+
+    std::cout << std::flush;
+    pid_t parent = getpid();
+    auto pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        if (place.cpus)
+            pin_to(place.cpus->reader);
+        channel->attach(role::reader, parent);
+        wakeup_reader(*channel, shared, opts);
+        exit(EXIT_SUCCESS);
+    }
+
+    cpu_set_t original_affinity = current_affinity();
+    if (place.cpus)
+        pin_to(place.cpus->writer);
+    channel->attach(role::writer, pid);
+    latency_histogram *latency = new latency_histogram;
+    double seconds = wakeup_writer(*channel, shared, opts, *latency);
+
+    int status;
+    if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+        std::cerr << std::format("Reader for {} did not finish cleanly", name) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    restore_affinity(original_affinity);
+    channel->teardown();
+    latency->merge(shared->reader_latency);
+
+    record result;
+    result.add("mode", mode_name(opts.mode))
+        .add("notifier", name)
+        .add("placement", placement_name(place.where))
+        .add("cpus", place.cpus ? std::format("{}/{}", place.cpus->writer, place.cpus->reader) : "-")
+        .add("rounds", static_cast<uint64_t>(opts.rounds))
+        .add("warmup", static_cast<uint64_t>(opts.warmup))
+        .add("wakeups_per_second", 2 * opts.rounds / seconds)
+        .add("latency_mean_ns", latency->mean())
+        .add("latency_p50_ns", latency->percentile(50))
+        .add("latency_p90_ns", latency->percentile(90))
+        .add("latency_p99_ns", latency->percentile(99))
+        .add("latency_p999_ns", latency->percentile(99.9))
+        .add("latency_max_ns", latency->max())
+        .add("histogram_ns", histogram_summary(*latency));
+
+    delete latency;
+    munmap(memory, sizeof(wakeup_shared));
+    return result;
+}
+
+static inline auto run_wakeup_benchmark(const options &opts, const std::vector<run_placement> &placements, reporter &output) -> void {
+    for (const auto &name : opts.notifiers)
+        for (const auto &place : placements)
+            output.add(wakeup_benchmark(name, place, opts));
+}
+
+#endif